@@ -0,0 +1,247 @@
+
+/*
+ * allocCheck.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Allocation budgets of the sfcUtil containers, run by 'make check'.
+ *
+ * Every case performs a standard operation with the allocator counted
+ * (see allocCount.c) and compares the calls, reallocs and peak bytes
+ * against a budget, so that a change adding a malloc() per put or per
+ * append fails here instead of showing up as a slow benchmark.  One
+ * line per budget:
+ *
+ * ok hash.put size=10000 allocs=10005 limit=10018
+ *
+ * A budget that is exceeded prints FAIL instead of ok and the program
+ * exits with 1.  The budgets are upper bounds: lowering the counts is
+ * fine, the limits can then be tightened.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utilft.h"
+#include "allocCount.h"
+
+/*
+ * elements of the container cases
+ */
+#define N 10000
+
+static int      failed;
+static char    *keys[N];
+static char     outBuf[BUFSIZ];
+
+static void
+budget(const char *name, const char *what, unsigned long got,
+       unsigned long limit)
+{
+  printf("%s %s size=%d %s=%lu limit=%lu\n", got <= limit ? "ok" : "FAIL",
+         name, N, what, got, limit);
+  if (got > limit)
+    failed = 1;
+}
+
+/*
+ * smallest l with 2^l >= n
+ */
+static unsigned long
+log2up(unsigned long n)
+{
+  unsigned long   l = 0;
+
+  while ((1UL << l) < n)
+    l++;
+  return l;
+}
+
+/*
+ * one node per put and one bucket array per rehash; the table grows by
+ * a constant factor, so there are O(log N) of those
+ */
+static void
+checkHashPut(void)
+{
+  UtilHashTable  *ht;
+  unsigned long   live;
+  int             i;
+
+  resetAllocCount();
+  live = allocCount.live;
+  ht = UtilFactory->newHashTable(61, UtilHashTable_charKey);
+  for (i = 0; i < N; i++)
+    ht->ft->put(ht, keys[i], keys[i]);
+  budget("hash.put", "allocs", allocCount.allocs, N + log2up(N) + 4);
+  budget("hash.put", "peakBytes", allocCount.peak - live, N * 48UL);
+
+  resetAllocCount();
+  for (i = 0; i < N; i++)
+    ht->ft->get(ht, keys[i]);
+  budget("hash.get", "allocs", allocCount.allocs, 0);
+
+  resetAllocCount();
+  for (i = 0; i < N; i++)
+    ht->ft->put(ht, keys[i], keys[N - 1 - i]);
+  budget("hash.replace", "allocs", allocCount.allocs, 0);
+
+  ht->ft->release(ht);
+  budget("hash.release", "leakedBytes", allocCount.live - live, 0);
+}
+
+/*
+ * in an arena the nodes come out of the chunks: the C library sees the
+ * chunks and the bucket arrays only
+ */
+static void
+checkHashPutInArena(void)
+{
+  UtilArena      *a;
+  UtilHashTable  *ht;
+  unsigned long   live;
+  int             i,
+                  round;
+
+  resetAllocCount();
+  live = allocCount.live;
+  a = UtilFactory->newArena(0);
+  for (round = 0; round < 2; round++) {
+    ht = UtilFactory->newHashTableInArena(a, 61, UtilHashTable_charKey);
+    for (i = 0; i < N; i++)
+      ht->ft->put(ht, keys[i], keys[i]);
+    if (round == 0)
+      budget("arena.hash.put", "allocs", allocCount.allocs,
+             N * 64UL / (64 * 1024) + 2 * log2up(N) + 4);
+    else
+      /*
+       * the chunks kept by resetArena() are enough for the same work
+       */
+      budget("arena.hash.putAfterReset", "allocs", allocCount.allocs,
+             2 * log2up(N));
+    UtilFactory->resetArena(a);
+    resetAllocCount();
+  }
+  UtilFactory->releaseArena(a);
+  budget("arena.release", "leakedBytes", allocCount.live - live, 0);
+}
+
+static void
+checkList(void)
+{
+  UtilList       *ul;
+  unsigned long   live;
+  void           *e;
+  int             i;
+
+  resetAllocCount();
+  live = allocCount.live;
+  ul = UtilFactory->newList(NULL, NULL);
+  for (i = 0; i < N; i++)
+    ul->ft->append(ul, keys[i]);
+  budget("list.append", "allocs", allocCount.allocs, N + 2);
+
+  resetAllocCount();
+  for (e = ul->ft->getFirst(ul); e; e = ul->ft->getNext(ul))
+    ;
+  budget("list.iterate", "allocs", allocCount.allocs, 0);
+
+  ul->ft->release(ul);
+  budget("list.release", "leakedBytes", allocCount.live - live, 0);
+}
+
+static void
+checkStringBuffer(void)
+{
+  UtilStringBuffer *sb;
+  unsigned long   live,
+                  total;
+  int             i;
+
+  resetAllocCount();
+  live = allocCount.live;
+  sb = UtilFactory->newStrinBuffer(8);
+  resetAllocCount();
+  sb->ft->append6Chars(sb, "<INSTANCENAME CLASSNAME=\"", "Linux_",
+                       "ComputerSystem", "\">", "<KEYBINDING NAME=\"",
+                       "CreationClassName\">");
+  budget("sb.append6Chars", "reallocs", allocCount.reallocs, 1);
+  budget("sb.append6Chars", "allocs", allocCount.allocs, 1);
+
+  /*
+   * doubling: O(log size) reallocs for N appends
+   */
+  sb->ft->reset(sb);
+  resetAllocCount();
+  total = 0;
+  for (i = 0; i < N; i++) {
+    sb->ft->appendChars(sb, keys[i]);
+    total += strlen(keys[i]);
+  }
+  budget("sb.appendChars", "reallocs", allocCount.reallocs,
+         log2up(total) + 1);
+  budget("sb.appendChars", "peakBytes", allocCount.peak - live,
+         4 * total + 256);
+
+  /*
+   * appending exactly the reserved size fits
+   */
+  sb->ft->release(sb);
+  sb = UtilFactory->newStrinBuffer(8);
+  sb->ft->reserve(sb, total);
+  resetAllocCount();
+  for (i = 0; i < N; i++)
+    sb->ft->appendChars(sb, keys[i]);
+  budget("sb.appendAfterReserve", "reallocs", allocCount.reallocs, 0);
+
+  /*
+   * a reset buffer keeps its capacity
+   */
+  sb->ft->reset(sb);
+  resetAllocCount();
+  for (i = 0; i < N; i++)
+    sb->ft->appendChars(sb, keys[i]);
+  budget("sb.appendAfterReset", "allocs", allocCount.allocs, 0);
+
+  sb->ft->release(sb);
+  budget("sb.release", "leakedBytes", allocCount.live - live, 0);
+}
+
+int
+main(void)
+{
+  char            key[32];
+  int             i;
+
+  /*
+   * a stdout buffer allocated by the first printf() would count as
+   * leaked by the first case
+   */
+  setvbuf(stdout, outBuf, _IOLBF, sizeof(outBuf));
+  for (i = 0; i < N; i++) {
+    snprintf(key, sizeof(key), "key%d", i * 7919);
+    keys[i] = strdup(key);
+  }
+
+  checkHashPut();
+  checkHashPutInArena();
+  checkList();
+  checkStringBuffer();
+
+  for (i = 0; i < N; i++)
+    free(keys[i]);
+  return failed;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
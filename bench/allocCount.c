@@ -0,0 +1,121 @@
+
+/*
+ * allocCount.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Counting malloc(), calloc(), realloc(), posix_memalign() and free()
+ * for the benchmarks and allocCheck.
+ *
+ * A program linked with this file interposes the C library allocator
+ * for itself and for libsfcUtil, which resolves malloc() to the
+ * executable's definition, and forwards to glibc's __libc_ entry
+ * points.  Live and peak bytes use malloc_usable_size(), so they include
+ * the allocator's rounding.  The counters are not atomic: the programs
+ * using them are single threaded.
+ *
+ */
+
+#include <stdlib.h>
+#include <malloc.h>
+#include <errno.h>
+#include "allocCount.h"
+
+extern void    *__libc_malloc(size_t size);
+extern void    *__libc_calloc(size_t n, size_t size);
+extern void    *__libc_realloc(void *p, size_t size);
+extern void    *__libc_memalign(size_t align, size_t size);
+extern void     __libc_free(void *p);
+
+AllocCount      allocCount;
+
+void
+resetAllocCount(void)
+{
+  unsigned long   live = allocCount.live;
+
+  allocCount.allocs = allocCount.reallocs = allocCount.frees = 0;
+  allocCount.bytes = 0;
+  allocCount.live = allocCount.peak = live;
+}
+
+static void
+counted(void *p, size_t size)
+{
+  if (p == NULL)
+    return;
+  allocCount.allocs++;
+  allocCount.bytes += size;
+  allocCount.live += malloc_usable_size(p);
+  if (allocCount.live > allocCount.peak)
+    allocCount.peak = allocCount.live;
+}
+
+void           *
+malloc(size_t size)
+{
+  void           *p = __libc_malloc(size);
+
+  counted(p, size);
+  return p;
+}
+
+void           *
+calloc(size_t n, size_t size)
+{
+  void           *p = __libc_calloc(n, size);
+
+  counted(p, n * size);
+  return p;
+}
+
+void           *
+realloc(void *p, size_t size)
+{
+  size_t          old = p ? malloc_usable_size(p) : 0;
+  void           *np = __libc_realloc(p, size);
+
+  if (np) {
+    allocCount.live -= old;
+    allocCount.reallocs++;
+    counted(np, size);
+  } else if (p && size == 0) {
+    allocCount.frees++;
+    allocCount.live -= old;
+  }
+  return np;
+}
+
+int
+posix_memalign(void **pp, size_t align, size_t size)
+{
+  void           *p = __libc_memalign(align, size);
+
+  if (p == NULL)
+    return ENOMEM;
+  counted(p, size);
+  *pp = p;
+  return 0;
+}
+
+void
+free(void *p)
+{
+  if (p == NULL)
+    return;
+  allocCount.frees++;
+  allocCount.live -= malloc_usable_size(p);
+  __libc_free(p);
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
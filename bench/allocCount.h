@@ -0,0 +1,42 @@
+
+/*
+ * allocCount.h
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Allocation counters of the benchmarks, see allocCount.c.
+ *
+ */
+
+#ifndef _ALLOCCOUNT_H_
+#define _ALLOCCOUNT_H_
+
+typedef struct {
+  unsigned long   allocs;       /* successful allocation calls */
+  unsigned long   reallocs;     /* realloc() calls among them */
+  unsigned long   frees;
+  unsigned long   bytes;        /* requested by those calls */
+  unsigned long   live,
+                  peak;         /* bytes in use and their maximum */
+} AllocCount;
+
+extern AllocCount allocCount;
+
+/*
+ * zeroes the counters, peak starts again from the bytes in use
+ */
+extern void     resetAllocCount(void);
+
+#endif                          /* _ALLOCCOUNT_H_ */
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,613 @@
+
+/*
+ * cimReplay.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * CIM workload generator and trace replay.
+ *
+ * Replays enumerate, get and associators requests the way sfcb handles
+ * them with the sfcUtil containers: object paths are parsed into key
+ * tables, instances are property tables looked up in a case insensitive
+ * instance cache by path, results are collected in lists and written
+ * out as CIM-XML into a string buffer.  Every request is timed; the
+ * throughput and latency percentiles are reported per request type:
+ *
+ * replay op=get count=14005 ops/s=136630.2 p50_ns=6448 p90_ns=11381
+ * p99_ns=16879 p999_ns=35903 max_ns=2216952
+ *
+ * Trace format, one request per line, blank separated, # starts a
+ * comment line; class lines must come before their first use:
+ *
+ *   class <ClassName> <instances> <keys> <Property>...
+ *        declares a class, its first <keys> properties are the keys
+ *   enum <ClassName>
+ *        enumerates all <instances> instances of the class
+ *   get <ObjectPath>
+ *        gets one instance, e.g.
+ *        get CIM_ComputerSystem.CreationClassName="CIM_ComputerSystem",Name="Name-7"
+ *   assoc <ObjectPath> <ResultClass> <count>
+ *        gets the source instance and <count> associated instances of
+ *        <ResultClass>
+ *
+ * Class names, property names and key names are case insensitive, key
+ * values must not contain blanks, quotes or commas.  Instances are
+ * created on the first get of their path and stay cached, as if a
+ * provider had returned them.
+ *
+ * usage: cimReplay                    generate 20000 requests and replay
+ *        cimReplay gen [requests [seed]]   write a generated trace
+ *        cimReplay replay <file>|-         replay a trace
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "utilft.h"
+
+#define OP_ENUM 0
+#define OP_GET 1
+#define OP_ASSOC 2
+#define OP_TYPES 3
+
+static const char *opNames[] = { "enum", "get", "assoc" };
+
+typedef struct {
+  char           *name;
+  long            instances;
+  int             keys,
+                  props;
+  char          **prop;         /* keys first */
+  char          **value;        /* default values of the others */
+} Class;
+
+typedef struct {
+  int             type;
+  Class          *cls;          /* enum: the class, assoc: the result */
+  char           *path;         /* get, assoc */
+  long            count;        /* assoc */
+} Op;
+
+typedef struct {
+  Class          *cls;
+  UtilHashTable  *props;        /* name -> value */
+} Instance;
+
+typedef struct {
+  UtilHashTable  *classes;      /* name -> Class */
+  UtilHashTable  *cache;        /* object path -> Instance */
+  UtilStringBuffer *out;        /* response of the current request */
+  UtilStringBuffer *path;
+  Op             *ops;
+  long            nops;
+} Replay;
+
+#define IGNORE_CASE (UtilHashTable_charKey | UtilHashTable_ignoreKeyCase)
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * the value of key k of instance idx, shared by the generator and the
+ * instances made up for enum and assoc
+ */
+static void
+keyValue(UtilStringBuffer * sb, Class * c, int k, long idx)
+{
+  if (k == 0)
+    sb->ft->appendChars(sb, c->name);
+  else {
+    sb->ft->append3Chars(sb, c->prop[k], "-", "");
+    sb->ft->appendUInt(sb, idx);
+  }
+}
+
+/*
+ * a made up instance; key values are taken from keys if given
+ */
+static UtilHashTable *
+newProps(Replay * r, Class * c, UtilHashTable * keys, long idx)
+{
+  UtilHashTable  *props =
+      UtilFactory->newHashTable(c->props * 2 + 1,
+                                IGNORE_CASE | UtilHashTable_managedValue);
+  const char     *v;
+  int             k;
+
+  for (k = 0; k < c->props; k++) {
+    if (k < c->keys) {
+      if (keys == NULL || (v = keys->ft->get(keys, c->prop[k])) == NULL) {
+        r->path->ft->reset(r->path);
+        keyValue(r->path, c, k, idx);
+        v = r->path->ft->getCharPtr(r->path);
+      }
+    } else
+      v = c->value[k];
+    props->ft->put(props, c->prop[k], strdup(v));
+  }
+  return props;
+}
+
+static void
+serialize(Replay * r, Class * c, UtilHashTable * props)
+{
+  UtilStringBuffer *out = r->out;
+  int             k;
+
+  out->ft->append3Chars(out, "<VALUE.NAMEDINSTANCE>\n<INSTANCE CLASSNAME=\"",
+                        c->name, "\">\n");
+  for (k = 0; k < c->props; k++) {
+    out->ft->append5Chars(out, "<PROPERTY NAME=\"", c->prop[k],
+                          "\" TYPE=\"string\">", "<VALUE>", "");
+    out->ft->appendXmlEscaped(out, props->ft->get(props, c->prop[k]));
+    SFCB_APPENDCHARS_BLOCK(out, "</VALUE></PROPERTY>\n");
+  }
+  SFCB_APPENDCHARS_BLOCK(out, "</INSTANCE>\n</VALUE.NAMEDINSTANCE>\n");
+}
+
+/*
+ * parses Class.key="value",... into keys, returns the class
+ */
+static Class   *
+parsePath(Replay * r, const char *path, UtilHashTable * keys)
+{
+  const char     *p = strchr(path, '.'),
+      *eq,
+      *end;
+  char            name[256];
+  size_t          n = p ? (size_t) (p - path) : strlen(path);
+
+  if (n >= sizeof(name))
+    return NULL;
+  memcpy(name, path, n);
+  name[n] = 0;
+  while (p && (*p == '.' || *p == ',')) {
+    if ((eq = strchr(++p, '=')) == NULL || eq[1] != '"'
+        || (end = strchr(eq + 2, '"')) == NULL)
+      break;
+    keys->ft->put(keys, strndup(p, eq - p), strndup(eq + 2, end - eq - 2));
+    p = end + 1;
+  }
+  return (Class *) r->classes->ft->get(r->classes, name);
+}
+
+static Instance *
+getInstance(Replay * r, const char *path)
+{
+  UtilHashTable  *keys = UtilFactory->newHashTable(7, IGNORE_CASE |
+                                                   UtilHashTable_managedKey
+                                                   |
+                                                   UtilHashTable_managedValue);
+  Class          *c = parsePath(r, path, keys);
+  Instance       *inst = NULL;
+
+  if (c) {
+    inst = (Instance *) r->cache->ft->get(r->cache, path);
+    if (inst == NULL) {
+      inst = (Instance *) malloc(sizeof(Instance));
+      inst->cls = c;
+      inst->props = newProps(r, c, keys, 0);
+      r->cache->ft->put(r->cache, strdup(path), inst);
+    }
+  }
+  keys->ft->release(keys);
+  return inst;
+}
+
+static void
+doEnum(Replay * r, Class * c)
+{
+  UtilList       *result = UtilFactory->newList(NULL, NULL);
+  UtilHashTable  *props;
+  long            i;
+
+  for (i = 0; i < c->instances; i++)
+    result->ft->append(result, newProps(r, c, NULL, i));
+  for (props = result->ft->getFirst(result); props;
+       props = result->ft->getNext(result)) {
+    serialize(r, c, props);
+    props->ft->release(props);
+  }
+  result->ft->release(result);
+}
+
+static void
+doGet(Replay * r, const char *path)
+{
+  Instance       *inst = getInstance(r, path);
+
+  if (inst)
+    serialize(r, inst->cls, inst->props);
+}
+
+static void
+doAssoc(Replay * r, const char *path, Class * rc, long count)
+{
+  UtilList       *result = UtilFactory->newList(NULL, NULL);
+  UtilStringBuffer *target = UtilFactory->newStrinBuffer(128);
+  Instance       *src = getInstance(r, path),
+      *inst;
+  unsigned long   h = 0;
+  const char     *p;
+  long            j;
+  int             k;
+
+  for (p = path; *p; p++)
+    h = h * 31 + tolower((unsigned char) *p);
+  for (j = 0; src && j < count; j++) {
+    target->ft->reset(target);
+    target->ft->append3Chars(target, rc->name, ".", "");
+    for (k = 0; k < rc->keys; k++) {
+      target->ft->append3Chars(target, k ? "," : "", rc->prop[k], "=\"");
+      keyValue(target, rc, k, (h + j) % rc->instances);
+      target->ft->appendChars(target, "\"");
+    }
+    if ((inst = getInstance(r, target->ft->getCharPtr(target))))
+      result->ft->append(result, inst);
+  }
+  for (inst = result->ft->getFirst(result); inst;
+       inst = result->ft->getNext(result))
+    serialize(r, inst->cls, inst->props);
+  target->ft->release(target);
+  result->ft->release(result);
+}
+
+/*
+ * the generator
+ */
+
+static unsigned long seed;
+
+static unsigned long
+rnd(void)
+{
+  seed = seed * 6364136223846793005ul + 1442695040888963407ul;
+  return seed >> 33;
+}
+
+static void
+randomCase(char *s, int percent)
+{
+  if ((long) (rnd() % 100) >= percent)
+    return;
+  for (; *s; s++)
+    *s = rnd() & 1 ? toupper((unsigned char) *s) :
+        tolower((unsigned char) *s);
+}
+
+#define GEN_CLASSES 24
+
+static void
+generate(FILE * f, long requests, unsigned long s)
+{
+  static const char *prefix[] = { "CIM_", "Linux_" };
+  static const char *base[] = {
+    "ComputerSystem", "EthernetPort", "LogicalDisk", "Processor",
+    "NetworkPort", "IPProtocolEndpoint", "FileSystem", "OperatingSystem",
+    "Memory", "PowerSupply", "Fan", "NumericSensor"
+  };
+  static const char *props[] = {
+    "Caption", "Description", "ElementName", "InstanceID",
+    "OperationalStatus", "StatusDescriptions", "Status", "HealthState",
+    "EnabledState", "OtherEnabledState", "RequestedState",
+    "EnabledDefault", "TimeOfLastStateChange", "InstallDate",
+    "PrimaryStatus", "DetailedStatus", "CommunicationStatus",
+    "OperatingStatus", "TransitioningToState", "AvailableRequestedStates",
+    "Generation", "PrimaryOwnerName", "PrimaryOwnerContact", "Roles",
+    "NameFormat", "OtherIdentifyingInfo", "IdentifyingDescriptions",
+    "Dedicated", "ResetCapability", "PowerManagementCapabilities"
+  };
+  char            cls[GEN_CLASSES][64],
+                  path[512],
+                  c1[64],
+                  k1[64],
+                  k2[64];
+  long            instances[GEN_CLASSES],
+                  i;
+  int             c,
+                  n,
+                  k,
+                  pick;
+
+  seed = s;
+  fprintf(f, "# generated by cimReplay gen %ld %lu\n", requests, s);
+  for (c = 0; c < GEN_CLASSES; c++) {
+    sprintf(cls[c], "%s%s", prefix[c / 12], base[c % 12]);
+    instances[c] = 10 + rnd() % 90;
+    n = 6 + rnd() % 24;
+    fprintf(f, "class %s %ld 2 CreationClassName Name", cls[c],
+            instances[c]);
+    for (k = 0; k < n; k++)
+      fprintf(f, " %s", props[(c + k) % 30]);
+    fputc('\n', f);
+  }
+  for (i = 0; i < requests; i++) {
+    /*
+     * a few classes take most of the requests
+     */
+    pick = rnd() % 100;
+    c = (int) ((unsigned long) pick * pick * GEN_CLASSES / 10000);
+    strcpy(c1, cls[c]);
+    randomCase(c1, 30);
+    strcpy(k1, "CreationClassName");
+    randomCase(k1, 20);
+    strcpy(k2, "Name");
+    randomCase(k2, 20);
+    sprintf(path, "%s.%s=\"%s\",%s=\"Name-%ld\"", c1, k1, cls[c], k2,
+            (long) (rnd() % instances[c]));
+    pick = rnd() % 100;
+    if (pick < 15)
+      fprintf(f, "enum %s\n", c1);
+    else if (pick < 85)
+      fprintf(f, "get %s\n", path);
+    else
+      fprintf(f, "assoc %s %s %ld\n", path, cls[(c + 1) % GEN_CLASSES],
+              1 + (long) (rnd() % 16));
+  }
+}
+
+/*
+ * loading and replaying
+ */
+
+static char    *
+readAll(FILE * f)
+{
+  size_t          len = 0,
+      max = 65536,
+      n;
+  char           *buf = (char *) malloc(max);
+
+  while ((n = fread(buf + len, 1, max - len - 1, f)) > 0)
+    if ((len += n) == max - 1)
+      buf = (char *) realloc(buf, max *= 2);
+  buf[len] = 0;
+  return buf;
+}
+
+static Class   *
+findClass(Replay * r, const char *name, long line)
+{
+  Class          *c = (Class *) r->classes->ft->get(r->classes, name);
+
+  if (c == NULL)
+    fprintf(stderr, "line %ld: unknown class %s\n", line, name);
+  return c;
+}
+
+/*
+ * parses the trace in buf, which is modified and must stay around
+ */
+static int
+load(Replay * r, char *buf)
+{
+  char           *line,
+                 *save,
+                 *tok[4096],
+                 *ts;
+  long            lineNo = 0,
+      max = 1024;
+  int             n,
+                  k;
+  Class          *c;
+  Op             *op;
+
+  r->ops = (Op *) malloc(max * sizeof(Op));
+  for (line = strtok_r(buf, "\n", &save); line;
+       line = strtok_r(NULL, "\n", &save)) {
+    lineNo++;
+    n = 0;
+    tok[0] = strtok_r(line, " \t\r", &ts);
+    while (tok[n] && n < 4095)
+      tok[++n] = strtok_r(NULL, " \t\r", &ts);
+    if (n == 0 || tok[0][0] == '#')
+      continue;
+    if (r->nops == max)
+      r->ops = (Op *) realloc(r->ops, (max *= 2) * sizeof(Op));
+    op = &r->ops[r->nops];
+
+    if (strcmp(tok[0], "class") == 0 && n >= 4) {
+      c = (Class *) calloc(1, sizeof(Class));
+      c->name = tok[1];
+      c->instances = atol(tok[2]);
+      c->keys = atoi(tok[3]);
+      c->props = n - 4;
+      if (c->instances <= 0 || c->keys < 1 || c->keys > c->props) {
+        fprintf(stderr, "line %ld: bad class\n", lineNo);
+        return 1;
+      }
+      c->prop = (char **) malloc(c->props * sizeof(char *));
+      c->value = (char **) malloc(c->props * sizeof(char *));
+      for (k = 0; k < c->props; k++) {
+        c->prop[k] = tok[4 + k];
+        c->value[k] = (char *) malloc(strlen(tok[4 + k]) +
+                                      strlen(c->name) + 8);
+        sprintf(c->value[k], "%s of <%s>", tok[4 + k], c->name);
+      }
+      r->classes->ft->put(r->classes, c->name, c);
+    } else if (strcmp(tok[0], "enum") == 0 && n == 2) {
+      op->type = OP_ENUM;
+      if ((op->cls = findClass(r, tok[1], lineNo)) == NULL)
+        return 1;
+      r->nops++;
+    } else if (strcmp(tok[0], "get") == 0 && n == 2) {
+      op->type = OP_GET;
+      op->path = tok[1];
+      r->nops++;
+    } else if (strcmp(tok[0], "assoc") == 0 && n == 4) {
+      op->type = OP_ASSOC;
+      op->path = tok[1];
+      if ((op->cls = findClass(r, tok[2], lineNo)) == NULL)
+        return 1;
+      op->count = atol(tok[3]);
+      r->nops++;
+    } else {
+      fprintf(stderr, "line %ld: cannot parse %s\n", lineNo, tok[0]);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int
+byValue(const void *a, const void *b)
+{
+  unsigned long   x = *(const unsigned long *) a,
+      y = *(const unsigned long *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void
+report(const char *name, unsigned long *ns, long n, double secs)
+{
+  if (n == 0)
+    return;
+  qsort(ns, n, sizeof(unsigned long), byValue);
+  printf("replay op=%s count=%ld ops/s=%.1f p50_ns=%lu p90_ns=%lu "
+         "p99_ns=%lu p999_ns=%lu max_ns=%lu\n", name, n, n / secs,
+         ns[(n - 1) * 50 / 100], ns[(n - 1) * 90 / 100],
+         ns[(n - 1) * 99 / 100], ns[(n - 1) * 999 / 1000], ns[n - 1]);
+}
+
+static int
+replay(FILE * f)
+{
+  Replay          r;
+  char           *buf = readAll(f);
+  unsigned long  *ns[OP_TYPES + 1];
+  long            count[OP_TYPES + 1] = { 0 },
+      i;
+  double          secs[OP_TYPES + 1] = { 0 },
+      start,
+      t;
+  Op             *op;
+  HashTableIterator *it;
+  Instance       *inst;
+  Class          *c;
+  void           *key;
+  int             k;
+
+  memset(&r, 0, sizeof(r));
+  r.classes = UtilFactory->newHashTable(61, IGNORE_CASE);
+  r.cache = UtilFactory->newHashTable(1021, IGNORE_CASE |
+                                      UtilHashTable_managedKey);
+  r.out = UtilFactory->newStrinBuffer(4096);
+  r.path = UtilFactory->newStrinBuffer(128);
+  if (load(&r, buf))
+    return 1;
+  for (k = 0; k <= OP_TYPES; k++)
+    ns[k] = (unsigned long *) malloc((r.nops + 1) * sizeof(unsigned long));
+
+  start = now();
+  for (i = 0; i < r.nops; i++) {
+    op = &r.ops[i];
+    t = now();
+    r.out->ft->reset(r.out);
+    switch (op->type) {
+    case OP_ENUM:
+      doEnum(&r, op->cls);
+      break;
+    case OP_GET:
+      doGet(&r, op->path);
+      break;
+    case OP_ASSOC:
+      doAssoc(&r, op->path, op->cls, op->count);
+      break;
+    }
+    t = now() - t;
+    ns[op->type][count[op->type]++] = (unsigned long) (t * 1e9);
+    ns[OP_TYPES][count[OP_TYPES]++] = (unsigned long) (t * 1e9);
+    secs[op->type] += t;
+  }
+  secs[OP_TYPES] = now() - start;
+
+  for (k = 0; k < OP_TYPES; k++)
+    report(opNames[k], ns[k], count[k], secs[k]);
+  report("all", ns[OP_TYPES], count[OP_TYPES], secs[OP_TYPES]);
+  printf("replay cached=%d seconds=%.3f\n", r.cache->ft->size(r.cache),
+         secs[OP_TYPES]);
+
+  for (it = r.cache->ft->getFirst(r.cache, &key, (void **) &inst); it;
+       it = r.cache->ft->getNext(r.cache, it, &key, (void **) &inst)) {
+    inst->props->ft->release(inst->props);
+    free(inst);
+  }
+  for (it = r.classes->ft->getFirst(r.classes, &key, (void **) &c); it;
+       it = r.classes->ft->getNext(r.classes, it, &key, (void **) &c)) {
+    for (k = 0; k < c->props; k++)
+      free(c->value[k]);
+    free(c->prop);
+    free(c->value);
+    free(c);
+  }
+  r.cache->ft->release(r.cache);
+  r.classes->ft->release(r.classes);
+  r.out->ft->release(r.out);
+  r.path->ft->release(r.path);
+  for (k = 0; k <= OP_TYPES; k++)
+    free(ns[k]);
+  free(r.ops);
+  free(buf);
+  return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  FILE           *f;
+  char           *buf;
+  size_t          len;
+  int             rc;
+
+  if (argc > 1 && strcmp(argv[1], "gen") == 0) {
+    generate(stdout, argc > 2 ? atol(argv[2]) : 20000,
+             argc > 3 ? strtoul(argv[3], NULL, 10) : 1);
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "replay") == 0) {
+    if (strcmp(argv[2], "-") == 0)
+      return replay(stdin);
+    if ((f = fopen(argv[2], "r")) == NULL) {
+      perror(argv[2]);
+      return 1;
+    }
+    rc = replay(f);
+    fclose(f);
+    return rc;
+  }
+  if (argc > 1) {
+    fprintf(stderr, "usage: %s [gen [requests [seed]] | replay file|-]\n",
+            argv[0]);
+    return 1;
+  }
+  f = open_memstream(&buf, &len);
+  generate(f, 20000, 1);
+  fclose(f);
+  f = fmemopen(buf, len, "r");
+  rc = replay(f);
+  fclose(f);
+  free(buf);
+  return rc;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
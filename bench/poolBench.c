@@ -0,0 +1,181 @@
+
+/*
+ * poolBench.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Provider fan-out: a number of requests each fan out into one task per
+ * provider, run by the work-stealing UtilThreadPool and by workers
+ * taking tasks from a mutex protected UtilList, with 1 - 64 threads.
+ *
+ * usage: poolBench [requests [providers]]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "utilft.h"
+
+/*
+ * the work of one provider call
+ */
+#define WORK 200
+
+static unsigned long done;
+
+static void
+provider(void *arg)
+{
+  volatile unsigned long x = (unsigned long) arg;
+  int             i;
+
+  for (i = 0; i < WORK; i++)
+    x = x * 6364136223846793005ul + 1442695040888963407ul;
+  __atomic_fetch_add(&done, 1, __ATOMIC_RELAXED);
+}
+
+static UtilThreadPool *pool;
+static unsigned long providers;
+
+static void
+request(void *arg)
+{
+  unsigned long   i;
+
+  for (i = 0; i < providers; i++)
+    pool->ft->submit(pool, provider, (void *) (i + 1));
+  __atomic_fetch_add(&done, 1, __ATOMIC_RELAXED);
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+report(const char *name, int threads, unsigned long requests,
+       double secs, int *rc)
+{
+  unsigned long   tasks = requests * (providers + 1);
+
+  printf("sched=%s threads=%d requests=%lu providers=%lu ns/task=%.1f "
+         "Mtasks/s=%.2f%s\n", name, threads, requests, providers,
+         secs * 1e9 / tasks, tasks / secs / 1e6,
+         done == tasks ? "" : " COUNT-MISMATCH");
+  *rc |= done != tasks;
+}
+
+static void
+runPool(int threads, unsigned long requests, int *rc)
+{
+  unsigned long   i;
+  double          start;
+
+  pool = UtilFactory->newThreadPool(threads);
+  done = 0;
+  start = now();
+  for (i = 0; i < requests; i++)
+    pool->ft->submit(pool, request, NULL);
+  pool->ft->wait(pool);
+  report("work-stealing", threads, requests, now() - start, rc);
+  pool->ft->release(pool);
+}
+
+/*
+ * the shared list scheduler: one list, one lock
+ */
+typedef struct {
+  UtilList       *tasks;
+  pthread_mutex_t lock;
+  unsigned long   left;         /* tasks not yet finished */
+} Shared;
+
+static void    *
+listWorker(void *arg)
+{
+  Shared         *s = (Shared *) arg;
+  void           *t;
+  unsigned long   i;
+
+  while (__atomic_load_n(&s->left, __ATOMIC_ACQUIRE)) {
+    pthread_mutex_lock(&s->lock);
+    t = s->tasks->ft->removeFirst(s->tasks);
+    pthread_mutex_unlock(&s->lock);
+    if (t == NULL) {
+      sched_yield();
+      continue;
+    }
+    if (t == (void *) -1) {
+      /*
+       * a request, fan out
+       */
+      pthread_mutex_lock(&s->lock);
+      for (i = 0; i < providers; i++)
+        s->tasks->ft->append(s->tasks, (void *) (i + 1));
+      pthread_mutex_unlock(&s->lock);
+      __atomic_fetch_add(&done, 1, __ATOMIC_RELAXED);
+    } else
+      provider(t);
+    __atomic_fetch_sub(&s->left, 1, __ATOMIC_RELEASE);
+  }
+  return NULL;
+}
+
+static void
+runList(int threads, unsigned long requests, int *rc)
+{
+  Shared          s;
+  pthread_t       tid[64];
+  unsigned long   i;
+  double          start;
+  int             k;
+
+  s.tasks = UtilFactory->newList(NULL, NULL);
+  pthread_mutex_init(&s.lock, NULL);
+  s.left = requests * (providers + 1);
+  done = 0;
+  start = now();
+  for (i = 0; i < requests; i++)
+    s.tasks->ft->append(s.tasks, (void *) -1);
+  for (k = 0; k < threads; k++)
+    pthread_create(&tid[k], NULL, listWorker, &s);
+  for (k = 0; k < threads; k++)
+    pthread_join(tid[k], NULL);
+  report("mutex-list", threads, requests, now() - start, rc);
+  pthread_mutex_destroy(&s.lock);
+  s.tasks->ft->release(s.tasks);
+}
+
+int
+main(int argc, char *argv[])
+{
+  unsigned long   requests = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000;
+  int             threads,
+                  rc = 0;
+
+  providers = argc > 2 ? strtoul(argv[2], NULL, 10) : 100;
+  for (threads = 1; threads <= 64; threads *= 2) {
+    runPool(threads, requests, &rc);
+    runList(threads, requests, &rc);
+  }
+  return rc;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,263 @@
+
+/*
+ * queueBench.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Throughput of the lock-free queues against a mutex protected
+ * UtilList, with 1 - 64 producer and consumer threads, and of the
+ * single producer/single consumer ring with and without batching.
+ *
+ * usage: queueBench [items]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "utilft.h"
+#include "genericlist.h"
+
+typedef struct {
+  const char     *name;
+  void           *q;
+  int             (*put) (void *q, void *elm);
+  void           *(*get) (void *q);
+} Target;
+
+typedef struct {
+  Target         *t;
+  unsigned long   from,
+                  count;
+  unsigned long  *left;         /* items not yet consumed */
+  unsigned long   sum;
+} Worker;
+
+static int
+queuePut(void *q, void *elm)
+{
+  return ((UtilQueue *) q)->ft->append((UtilQueue *) q, elm);
+}
+
+static void    *
+queueGet(void *q)
+{
+  return ((UtilQueue *) q)->ft->removeFirst((UtilQueue *) q);
+}
+
+static pthread_mutex_t listLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int
+listPut(void *q, void *elm)
+{
+  pthread_mutex_lock(&listLock);
+  ((UtilList *) q)->ft->append((UtilList *) q, elm);
+  pthread_mutex_unlock(&listLock);
+  return 0;
+}
+
+static void    *
+listGet(void *q)
+{
+  void           *elm;
+
+  pthread_mutex_lock(&listLock);
+  elm = ((UtilList *) q)->ft->removeFirst((UtilList *) q);
+  pthread_mutex_unlock(&listLock);
+  return elm;
+}
+
+static void    *
+produce(void *arg)
+{
+  Worker         *w = (Worker *) arg;
+  unsigned long   i;
+
+  for (i = w->from; i < w->from + w->count; i++)
+    while (w->t->put(w->t->q, (void *) (i + 1)))
+      sched_yield();            /* full */
+  return NULL;
+}
+
+static void    *
+consume(void *arg)
+{
+  Worker         *w = (Worker *) arg;
+  void           *elm;
+
+  while (__atomic_load_n(w->left, __ATOMIC_RELAXED)) {
+    if ((elm = w->t->get(w->t->q)) == NULL) {
+      sched_yield();
+      continue;
+    }
+    w->sum += (unsigned long) elm;
+    __atomic_fetch_sub(w->left, 1, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int
+run(Target * t, int threads, unsigned long items)
+{
+  pthread_t       tid[128];
+  Worker          w[128];
+  unsigned long   left = items,
+      sum = 0;
+  double          start,
+                  secs;
+  int             i;
+
+  start = now();
+  for (i = 0; i < threads; i++) {
+    w[i].t = t;
+    w[i].from = items / threads * i;
+    w[i].count = (i == threads - 1) ? items - w[i].from : items / threads;
+    pthread_create(&tid[i], NULL, produce, &w[i]);
+  }
+  for (i = threads; i < 2 * threads; i++) {
+    w[i].t = t;
+    w[i].left = &left;
+    w[i].sum = 0;
+    pthread_create(&tid[i], NULL, consume, &w[i]);
+  }
+  for (i = 0; i < 2 * threads; i++)
+    pthread_join(tid[i], NULL);
+  secs = now() - start;
+
+  for (i = threads; i < 2 * threads; i++)
+    sum += w[i].sum;
+  printf("queue=%s producers=%d consumers=%d items=%lu ns/op=%.1f "
+         "Mops/s=%.2f%s\n", t->name, threads, threads, items,
+         secs * 1e9 / items, items / secs / 1e6,
+         sum == items * (items + 1) / 2 ? "" : " CHECKSUM-MISMATCH");
+  return sum != items * (items + 1) / 2;
+}
+
+typedef struct {
+  Generic_spsc_ring ring;
+  unsigned long   items,
+                  batch,
+                  sum;
+} Spsc;
+
+static void    *
+spscProduce(void *arg)
+{
+  Spsc           *s = (Spsc *) arg;
+  void           *buf[64];
+  unsigned long   i = 0,
+      n,
+      k;
+
+  while (i < s->items) {
+    n = s->items - i < s->batch ? s->items - i : s->batch;
+    for (k = 0; k < n; k++)
+      buf[k] = (void *) (i + k + 1);
+    for (k = 0; k < n;)
+      if ((k += spsc_push_batch(&s->ring, buf + k, n - k)) < n)
+        sched_yield();
+    i += n;
+  }
+  return NULL;
+}
+
+static void    *
+spscConsume(void *arg)
+{
+  Spsc           *s = (Spsc *) arg;
+  void           *buf[64];
+  unsigned long   got = 0,
+      n,
+      k;
+
+  while (got < s->items) {
+    if ((n = spsc_pop_batch(&s->ring, buf, s->batch)) == 0) {
+      sched_yield();
+      continue;
+    }
+    for (k = 0; k < n; k++)
+      s->sum += (unsigned long) buf[k];
+    got += n;
+  }
+  return NULL;
+}
+
+static int
+runSpsc(unsigned long items, unsigned long batch)
+{
+  Spsc            s;
+  pthread_t       p,
+                  c;
+  double          start,
+                  secs;
+
+  initialize_spsc_ring(&s.ring, 1024);
+  s.items = items;
+  s.batch = batch;
+  s.sum = 0;
+  start = now();
+  pthread_create(&p, NULL, spscProduce, &s);
+  pthread_create(&c, NULL, spscConsume, &s);
+  pthread_join(p, NULL);
+  pthread_join(c, NULL);
+  secs = now() - start;
+  destroy_spsc_ring(&s.ring);
+
+  printf("queue=spsc batch=%lu producers=1 consumers=1 items=%lu "
+         "ns/op=%.1f Mops/s=%.2f%s\n", batch, items, secs * 1e9 / items,
+         items / secs / 1e6,
+         s.sum == items * (items + 1) / 2 ? "" : " CHECKSUM-MISMATCH");
+  return s.sum != items * (items + 1) / 2;
+}
+
+int
+main(int argc, char *argv[])
+{
+  unsigned long   items = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  Target          targets[3] = {
+    {"ring", NULL, queuePut, queueGet},
+    {"segmented", NULL, queuePut, queueGet},
+    {"mutex-list", NULL, listPut, listGet}
+  };
+  int             threads,
+                  i,
+                  rc = 0;
+
+  targets[0].q = UtilFactory->newQueue(1024);
+  targets[1].q = UtilFactory->newQueue(0);
+  targets[2].q = UtilFactory->newList(NULL, NULL);
+
+  for (threads = 1; threads <= 64; threads *= 2)
+    for (i = 0; i < 3; i++)
+      rc |= run(&targets[i], threads, items);
+  rc |= runSpsc(items, 1);
+  rc |= runSpsc(items, 64);
+
+  ((UtilQueue *) targets[0].q)->ft->release((UtilQueue *) targets[0].q);
+  ((UtilQueue *) targets[1].q)->ft->release((UtilQueue *) targets[1].q);
+  ((UtilList *) targets[2].q)->ft->release((UtilList *) targets[2].q);
+  return rc;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
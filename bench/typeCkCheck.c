@@ -0,0 +1,148 @@
+
+/*
+ * typeCkCheck.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Values the utilTypeCk validators must accept or reject, run by
+ * 'make check'.  One line per value:
+ *
+ * ok real64 ".inf" invalid=1
+ *
+ * A value judged otherwise prints FAIL instead of ok and the program
+ * exits with 1.  The real cases are the spellings where the own real
+ * parser and strtod() can disagree; strtod() is the reference.  The
+ * slice cases go through invalid_value_n() with an explicit length,
+ * a NUL inside the slice must not end the value early.
+ *
+ */
+
+#include <stdio.h>
+#include "utilTypeCk.h"
+
+typedef struct {
+  const char     *v;
+  int             invalid;
+} Case;
+
+static const Case realCases[] = {
+  {"1.5", 0},
+  {"-1.", 0},
+  {".5", 0},
+  {"+.5e-3", 0},
+  {"1e30", 0},
+  {"0x1p3", 0},
+  {"inf", 0},
+  {"-Infinity", 0},
+  {"+INF", 0},
+  {"nan", 0},
+  {"-NaN", 0},
+  {".", 1},
+  {"-.", 1},
+  {".e5", 1},
+  {"1e", 1},
+  {"1.5x", 1},
+  {"infx", 1},
+  {"in", 1},
+  {".inf", 1},
+  {"-.nan", 1},
+  {"+.infinity", 1},
+  {".naN", 1},
+  {"1.inf", 1},
+  {NULL}
+};
+
+static const struct {
+  const char     *name;
+  CMPIType        type;
+} realTypes[] = {
+  {"real32", CMPI_real32},
+  {"real64", CMPI_real64},
+  {NULL}
+};
+
+typedef struct {
+  const char     *name;
+  CMPIType        type;
+  const char     *v;
+  size_t          len;
+  int             invalid;
+} Slice;
+
+static const Slice sliceCases[] = {
+  {"real64", CMPI_real64, "0x1p3", 5, 0},
+  {"real64", CMPI_real64, "0x1\0zzz", 7, 1},
+  {"real32", CMPI_real32, "0x1\0zzz", 7, 1},
+  {"real64", CMPI_real64, "1.5\0", 4, 1},
+  {"real64", CMPI_real64, "1.5xyz", 3, 0},
+  {"uint32", CMPI_uint32, "42\0", 3, 1},
+  {"string", CMPI_string, "abc", 3, 0},
+  {"string", CMPI_string, "ab\0c", 4, 1},
+  {"string", CMPI_string, "0123456789abcdef\0" "0123456789abcdef", 33, 1},
+  {"string", CMPI_string, "01234\0" "6789abcdef0123456789abcdef", 32, 1},
+  {"string", CMPI_string, "0123456789abcdef0123456789abcdef", 32, 0},
+  {"char16", CMPI_char16, "\0", 1, 1},
+  {"char16", CMPI_char16, "a\0", 2, 1},
+  {"char16", CMPI_char16, "\xc3\xa4", 2, 0},
+  {"char16", CMPI_char16, "\xc3\0", 2, 1},
+  {"boolean", CMPI_boolean, "true\0", 5, 1},
+  {NULL}
+};
+
+/*
+ * prints v[0] .. v[len-1] with NUL and non ASCII bytes escaped
+ */
+static void
+printSlice(const char *v, size_t len)
+{
+  size_t          i;
+
+  for (i = 0; i < len; i++)
+    if (v[i] == 0)
+      printf("\\0");
+    else if ((unsigned char) v[i] >= 0x80)
+      printf("\\x%02x", (unsigned char) v[i]);
+    else
+      putchar(v[i]);
+}
+
+int
+main(void)
+{
+  const Case     *c;
+  const Slice    *sl;
+  int             t,
+                  got,
+                  failed = 0;
+
+  for (t = 0; realTypes[t].name; t++)
+    for (c = realCases; c->v; c++) {
+      got = invalid_value(c->v, realTypes[t].type) != 0;
+      printf("%s %s \"%s\" invalid=%d\n", got == c->invalid ? "ok" : "FAIL",
+             realTypes[t].name, c->v, got);
+      if (got != c->invalid)
+        failed = 1;
+    }
+
+  for (sl = sliceCases; sl->v; sl++) {
+    got = invalid_value_n(sl->v, sl->len, sl->type) != 0;
+    printf("%s %s \"", got == sl->invalid ? "ok" : "FAIL", sl->name);
+    printSlice(sl->v, sl->len);
+    printf("\" len=%lu invalid=%d\n", (unsigned long) sl->len, got);
+    if (got != sl->invalid)
+      failed = 1;
+  }
+  return failed;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,658 @@
+
+/*
+ * utilBench.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Micro benchmarks of the sfcUtil containers and type checks: hash
+ * table put/get/remove/iterate per key type and size, list
+ * append/iterate/remove, string buffer append patterns and the
+ * utilTypeCk validators.
+ *
+ * Keys come from a fixed seed, so runs are repeatable.  Every case is
+ * run RUNS times after a warm up and the median is reported, one line
+ * per case:
+ *
+ * bench=hash.get keys=charKey size=1000 ops=200000 ns/op=21.3
+ * allocs/op=0.000 bytes/op=0.0
+ *
+ * allocs/op and bytes/op count the malloc() family calls made while
+ * the case runs, see allocCount.c.
+ *
+ * usage: utilBench [filter], filter selects the cases whose bench name
+ * contains it
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "utilft.h"
+#include "utilTypeCk.h"
+#include "allocCount.h"
+
+#define RUNS 5
+
+/*
+ * operations per run, the work of the smaller cases is repeated
+ */
+#define OPS 200000
+
+typedef struct {
+  void           *hdl;
+  void           *ft;
+} CMPI_String;                  /* as utilHashtable.c sees CMPIString */
+
+typedef struct {
+  const char     *keyName;
+  long            opt,
+                  size;
+  char          **keys,
+                **lookups,      /* mixed case for ignoreKeyCase */
+                **misses;
+  CMPI_String    *skeys,
+                 *slookups,
+                 *smisses;
+  UtilHashTable  *ht;
+  UtilList       *ul;
+  UtilStringBuffer *sb;
+  void          **many;         /* rounds() tables or lists to remove
+                                 * from */
+} Ctx;
+
+typedef struct {
+  const char     *name;
+  void            (*setup) (Ctx * c);
+  unsigned long   (*run) (Ctx * c);     /* returns the operations done */
+  void            (*teardown) (Ctx * c);
+} Bench;
+
+static unsigned long seed;
+
+static unsigned long
+rnd(void)
+{
+  seed = seed * 6364136223846793005ul + 1442695040888963407ul;
+  return seed >> 33;
+}
+
+static double
+now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * CIM like property names: a shared prefix and a random tail
+ */
+static void
+makeKeys(Ctx * c)
+{
+  static const char *prefix[] = {
+    "CIM_", "Name", "Element", "SystemCreationClassName", "Instance", "x"
+  };
+  long            i,
+                  k;
+  size_t          n;
+
+  seed = 42;
+  c->keys = (char **) malloc(c->size * sizeof(char *));
+  c->lookups = (char **) malloc(c->size * sizeof(char *));
+  c->misses = (char **) malloc(c->size * sizeof(char *));
+  c->skeys = (CMPI_String *) malloc(c->size * sizeof(CMPI_String));
+  c->slookups = (CMPI_String *) malloc(c->size * sizeof(CMPI_String));
+  c->smisses = (CMPI_String *) malloc(c->size * sizeof(CMPI_String));
+  for (i = 0; i < c->size; i++) {
+    c->keys[i] = (char *) malloc(48);
+    n = sprintf(c->keys[i], "%s%lx_%ld", prefix[rnd() % 6], rnd(), i);
+    c->lookups[i] = strdup(c->keys[i]);
+    if (c->opt & UtilHashTable_ignoreKeyCase)
+      for (k = 0; k < (long) n; k++)
+        c->lookups[i][k] = rnd() & 1 ? toupper(c->keys[i][k]) :
+            tolower(c->keys[i][k]);
+    c->misses[i] = (char *) malloc(n + 2);
+    sprintf(c->misses[i], "%s#", c->keys[i]);
+    c->skeys[i].hdl = c->keys[i];
+    c->slookups[i].hdl = c->lookups[i];
+    c->smisses[i].hdl = c->misses[i];
+    c->skeys[i].ft = c->slookups[i].ft = c->smisses[i].ft = NULL;
+  }
+}
+
+static void
+freeKeys(Ctx * c)
+{
+  long            i;
+
+  for (i = 0; i < c->size; i++) {
+    free(c->keys[i]);
+    free(c->lookups[i]);
+    free(c->misses[i]);
+  }
+  free(c->keys);
+  free(c->lookups);
+  free(c->misses);
+  free(c->skeys);
+  free(c->slookups);
+  free(c->smisses);
+}
+
+static void   *
+key(Ctx * c, long i)
+{
+  return c->opt & UtilHashTable_CMPIStringKey ? (void *) &c->skeys[i] :
+      (void *) c->keys[i];
+}
+
+static void   *
+lookup(Ctx * c, long i)
+{
+  return c->opt & UtilHashTable_CMPIStringKey ? (void *) &c->slookups[i] :
+      (void *) c->lookups[i];
+}
+
+static void   *
+miss(Ctx * c, long i)
+{
+  return c->opt & UtilHashTable_CMPIStringKey ? (void *) &c->smisses[i] :
+      (void *) c->misses[i];
+}
+
+static long
+rounds(Ctx * c)
+{
+  return c->size < OPS ? OPS / c->size : 1;
+}
+
+static UtilHashTable *
+newFilledTable(Ctx * c)
+{
+  UtilHashTable  *ht = UtilFactory->newHashTable(61, c->opt);
+  long            i;
+
+  for (i = 0; i < c->size; i++)
+    ht->ft->put(ht, key(c, i), c->keys[i]);
+  return ht;
+}
+
+static void
+htFill(Ctx * c)
+{
+  c->ht = newFilledTable(c);
+}
+
+static void
+htRelease(Ctx * c)
+{
+  c->ht->ft->release(c->ht);
+}
+
+static void
+htFillMany(Ctx * c)
+{
+  long            r;
+
+  c->many = (void **) malloc(rounds(c) * sizeof(void *));
+  for (r = 0; r < rounds(c); r++)
+    c->many[r] = newFilledTable(c);
+}
+
+static void
+htReleaseMany(Ctx * c)
+{
+  long            r;
+
+  for (r = 0; r < rounds(c); r++)
+    ((UtilHashTable *) c->many[r])->ft->release(c->many[r]);
+  free(c->many);
+}
+
+static void
+nothing(Ctx * c)
+{
+}
+
+/*
+ * a fresh table per round, so the rehashes while growing are included
+ */
+static unsigned long
+htPut(Ctx * c)
+{
+  long            r,
+                  i;
+
+  for (r = rounds(c); r; r--) {
+    c->ht = UtilFactory->newHashTable(61, c->opt);
+    for (i = 0; i < c->size; i++)
+      c->ht->ft->put(c->ht, key(c, i), c->keys[i]);
+    htRelease(c);
+  }
+  return rounds(c) * c->size;
+}
+
+static unsigned long
+htGet(Ctx * c)
+{
+  long            r,
+                  i;
+  unsigned long   found = 0;
+
+  for (r = rounds(c); r; r--)
+    for (i = 0; i < c->size; i++)
+      found += c->ht->ft->get(c->ht, lookup(c, i)) != NULL;
+  if (found != rounds(c) * c->size)
+    fprintf(stderr, "hash.get: %lu lookups failed\n",
+            rounds(c) * c->size - found);
+  return rounds(c) * c->size;
+}
+
+static unsigned long
+htGetMiss(Ctx * c)
+{
+  long            r,
+                  i;
+
+  for (r = rounds(c); r; r--)
+    for (i = 0; i < c->size; i++)
+      c->ht->ft->get(c->ht, miss(c, i));
+  return rounds(c) * c->size;
+}
+
+static unsigned long
+htIterate(Ctx * c)
+{
+  long            r;
+  HashTableIterator *it;
+  void           *k,
+                 *v;
+  unsigned long   n = 0;
+
+  for (r = rounds(c); r; r--)
+    for (it = c->ht->ft->getFirst(c->ht, &k, &v); it;
+         it = c->ht->ft->getNext(c->ht, it, &k, &v))
+      n++;
+  return n;
+}
+
+/*
+ * empties the tables htFillMany() made
+ */
+static unsigned long
+htRemove(Ctx * c)
+{
+  long            r,
+                  i;
+  UtilHashTable  *ht;
+
+  for (r = 0; r < rounds(c); r++)
+    for (ht = (UtilHashTable *) c->many[r], i = 0; i < c->size; i++)
+      ht->ft->remove(ht, lookup(c, i));
+  return rounds(c) * c->size;
+}
+
+static UtilList *
+newFilledList(Ctx * c)
+{
+  UtilList       *ul = UtilFactory->newList(NULL, NULL);
+  long            i;
+
+  for (i = 0; i < c->size; i++)
+    ul->ft->append(ul, c->keys[i]);
+  return ul;
+}
+
+static void
+listFill(Ctx * c)
+{
+  c->ul = newFilledList(c);
+}
+
+static void
+listRelease(Ctx * c)
+{
+  c->ul->ft->release(c->ul);
+}
+
+static void
+listFillMany(Ctx * c)
+{
+  long            r;
+
+  c->many = (void **) malloc(rounds(c) * sizeof(void *));
+  for (r = 0; r < rounds(c); r++)
+    c->many[r] = newFilledList(c);
+}
+
+static void
+listReleaseMany(Ctx * c)
+{
+  long            r;
+
+  for (r = 0; r < rounds(c); r++)
+    ((UtilList *) c->many[r])->ft->release(c->many[r]);
+  free(c->many);
+}
+
+static unsigned long
+listAppend(Ctx * c)
+{
+  long            r,
+                  i;
+
+  for (r = rounds(c); r; r--) {
+    c->ul = UtilFactory->newList(NULL, NULL);
+    for (i = 0; i < c->size; i++)
+      c->ul->ft->append(c->ul, c->keys[i]);
+    listRelease(c);
+  }
+  return rounds(c) * c->size;
+}
+
+static unsigned long
+listIterate(Ctx * c)
+{
+  long            r;
+  void           *e;
+  unsigned long   n = 0;
+
+  for (r = rounds(c); r; r--)
+    for (e = c->ul->ft->getFirst(c->ul); e; e = c->ul->ft->getNext(c->ul))
+      n++;
+  return n;
+}
+
+static unsigned long
+listRemoveFirst(Ctx * c)
+{
+  long            r,
+                  i;
+  UtilList       *ul;
+
+  for (r = 0; r < rounds(c); r++)
+    for (ul = (UtilList *) c->many[r], i = 0; i < c->size; i++)
+      ul->ft->removeFirst(ul);
+  return rounds(c) * c->size;
+}
+
+/*
+ * every other element while iterating, as filters do; ops counts the
+ * elements visited
+ */
+static unsigned long
+listRemoveCurrent(Ctx * c)
+{
+  long            r;
+  void           *e;
+  UtilList       *ul;
+  unsigned long   n = 0;
+
+  for (r = 0; r < rounds(c); r++)
+    for (ul = (UtilList *) c->many[r], e = ul->ft->getFirst(ul); e;
+         e = ul->ft->getNext(ul))
+      if (n++ & 1)
+        ul->ft->removeCurrent(ul);
+  return n;
+}
+
+static void
+sbNew(Ctx * c)
+{
+  c->sb = UtilFactory->newStrinBuffer(64);
+}
+
+static void
+sbRelease(Ctx * c)
+{
+  c->sb->ft->release(c->sb);
+}
+
+/*
+ * the buffer is reset every 1000 appends, as when one response is
+ * written after the other
+ */
+#define SB_LOOP(stmt) \
+  long i; \
+  for (i = 0; i < OPS; i++) { \
+    if (i % 1000 == 0) \
+      c->sb->ft->reset(c->sb); \
+    stmt; \
+  } \
+  return OPS;
+
+static unsigned long
+sbAppendChars(Ctx * c)
+{
+  SB_LOOP(c->sb->ft->appendChars(c->sb, "<PROPERTY NAME=\""))
+}
+
+static unsigned long
+sbAppendBlock(Ctx * c)
+{
+  SB_LOOP(SFCB_APPENDCHARS_BLOCK(c->sb, "</PROPERTY>\n"))
+}
+
+static unsigned long
+sbAppend3Chars(Ctx * c)
+{
+  SB_LOOP(c->sb->ft->append3Chars(c->sb, "<VALUE>", "42", "</VALUE>\n"))
+}
+
+static unsigned long
+sbAppend6Chars(Ctx * c)
+{
+  SB_LOOP(c->sb->ft->append6Chars(c->sb, "<PROPERTY NAME=\"", "Name",
+                                  "\" TYPE=\"", "string", "\">", "\n"))
+}
+
+static unsigned long
+sbAppendUInt(Ctx * c)
+{
+  SB_LOOP(c->sb->ft->appendUInt(c->sb, 1234567ull * i))
+}
+
+static unsigned long
+sbAppendXmlEscaped(Ctx * c)
+{
+  SB_LOOP(c->sb->ft->appendXmlEscaped(c->sb, "a < b && \"c\""))
+}
+
+/*
+ * one string of 64 appends grown from empty, then detached
+ */
+static unsigned long
+sbGrow(Ctx * c)
+{
+  long            r,
+                  i;
+  UtilStringBuffer *sb;
+  unsigned int    len;
+  int             mapped;
+
+  for (r = 0; r < OPS / 64; r++) {
+    sb = UtilFactory->newStrinBuffer(0);
+    for (i = 0; i < 64; i++)
+      sb->ft->appendChars(sb, "CIM_ComputerSystem.Name=\"host\",");
+    mapped = sb->mapped;
+    sb->ft->releaseDetached(sb->ft->detach(sb, &len), len, mapped);
+    sb->ft->release(sb);
+  }
+  return OPS / 64 * 64;
+}
+
+typedef struct {
+  const char     *v;
+  CMPIType        type;
+} TypeCase;
+
+static const TypeCase typeCases[] = {
+  {"4294967295", CMPI_uint32},
+  {"-9223372036854775808", CMPI_sint64},
+  {"3.14159265358979e+10", CMPI_real64},
+  {"TRUE", CMPI_boolean},
+  {"20261016120000.000000+000", CMPI_dateTime},
+  {NULL, 0}
+};
+
+static unsigned long
+typeInvalid(Ctx * c)
+{
+  long            i;
+  const TypeCase *t;
+  unsigned long   bad = 0;
+
+  for (i = 0; i < OPS / 5; i++)
+    for (t = typeCases; t->v; t++)
+      bad += invalid_value(t->v, t->type);
+  if (bad)
+    fprintf(stderr, "typeck.invalid: %lu values rejected\n", bad);
+  return OPS / 5 * 5;
+}
+
+static unsigned long
+typeParse(Ctx * c)
+{
+  long            i;
+  const TypeCase *t;
+  CMPIValue       v;
+
+  for (i = 0; i < OPS / 5; i++)
+    for (t = typeCases; t->v; t++)
+      parse_value(t->v, t->type, &v);
+  return OPS / 5 * 5;
+}
+
+static const Bench hashBenches[] = {
+  {"hash.put", nothing, htPut, nothing},
+  {"hash.get", htFill, htGet, htRelease},
+  {"hash.getMiss", htFill, htGetMiss, htRelease},
+  {"hash.iterate", htFill, htIterate, htRelease},
+  {"hash.remove", htFillMany, htRemove, htReleaseMany},
+  {NULL}
+};
+
+static const Bench listBenches[] = {
+  {"list.append", nothing, listAppend, nothing},
+  {"list.iterate", listFill, listIterate, listRelease},
+  {"list.removeFirst", listFillMany, listRemoveFirst, listReleaseMany},
+  {"list.removeCurrent", listFillMany, listRemoveCurrent, listReleaseMany},
+  {NULL}
+};
+
+static const Bench otherBenches[] = {
+  {"sb.appendChars", sbNew, sbAppendChars, sbRelease},
+  {"sb.appendBlock", sbNew, sbAppendBlock, sbRelease},
+  {"sb.append3Chars", sbNew, sbAppend3Chars, sbRelease},
+  {"sb.append6Chars", sbNew, sbAppend6Chars, sbRelease},
+  {"sb.appendUInt", sbNew, sbAppendUInt, sbRelease},
+  {"sb.appendXmlEscaped", sbNew, sbAppendXmlEscaped, sbRelease},
+  {"sb.grow", nothing, sbGrow, nothing},
+  {"typeck.invalid", nothing, typeInvalid, nothing},
+  {"typeck.parse", nothing, typeParse, nothing},
+  {NULL}
+};
+
+static int
+byTime(const void *a, const void *b)
+{
+  double          x = *(const double *) a,
+      y = *(const double *) b;
+
+  return x < y ? -1 : x > y;
+}
+
+/*
+ * params is printed after the bench name
+ */
+static void
+measure(const Bench * b, Ctx * c, const char *params)
+{
+  double          ns[RUNS],
+                  start;
+  unsigned long   ops = 0,
+      allocs[RUNS],
+      bytes[RUNS];
+  int             i;
+
+  b->setup(c);
+  b->run(c);                    /* warm up */
+  b->teardown(c);
+  for (i = 0; i < RUNS; i++) {
+    b->setup(c);
+    resetAllocCount();
+    start = now();
+    ops = b->run(c);
+    ns[i] = (now() - start) * 1e9 / ops;
+    allocs[i] = allocCount.allocs;
+    bytes[i] = allocCount.bytes;
+    b->teardown(c);
+  }
+  qsort(ns, RUNS, sizeof(double), byTime);
+  printf("bench=%s %sops=%lu ns/op=%.1f allocs/op=%.3f bytes/op=%.1f\n",
+         b->name, params, ops, ns[RUNS / 2], (double) allocs[0] / ops,
+         (double) bytes[0] / ops);
+}
+
+int
+main(int argc, char *argv[])
+{
+  static const struct {
+    const char     *name;
+    long            opt;
+  } keyTypes[] = {
+    {"charKey", UtilHashTable_charKey},
+    {"charKey+ignoreKeyCase",
+     UtilHashTable_charKey | UtilHashTable_ignoreKeyCase},
+    {"CMPIStringKey", UtilHashTable_CMPIStringKey},
+    {"CMPIStringKey+ignoreKeyCase",
+     UtilHashTable_CMPIStringKey | UtilHashTable_ignoreKeyCase},
+    {NULL, 0}
+  };
+  static const long sizes[] = { 16, 1000, 100000, 0 };
+  const char     *filter = argc > 1 ? argv[1] : "";
+  const Bench    *b;
+  Ctx             c;
+  char            params[128];
+  int             k,
+                  s;
+
+  memset(&c, 0, sizeof(c));
+  for (k = 0; keyTypes[k].name; k++)
+    for (s = 0; sizes[s]; s++) {
+      c.keyName = keyTypes[k].name;
+      c.opt = keyTypes[k].opt;
+      c.size = sizes[s];
+      makeKeys(&c);
+      snprintf(params, sizeof(params), "keys=%s size=%ld ", c.keyName,
+               c.size);
+      for (b = hashBenches; b->name; b++)
+        if (strstr(b->name, filter))
+          measure(b, &c, params);
+      snprintf(params, sizeof(params), "size=%ld ", c.size);
+      if (k == 0)
+        for (b = listBenches; b->name; b++)
+          if (strstr(b->name, filter))
+            measure(b, &c, params);
+      freeKeys(&c);
+    }
+  for (b = otherBenches; b->name; b++)
+    if (strstr(b->name, filter))
+      measure(b, &c, "");
+  return 0;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
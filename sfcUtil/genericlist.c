@@ -36,16 +36,22 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "genericlist.h"
+#include "utilAlloc.h"
+#include "utilRegistry.h"
 
 #ifdef THINK_C /* what is this? */
 #define malloc NewPtr
 #endif
 
-#define NEW(x) ((x *) emalloc(sizeof(x)))
+#define NEW_IN(a, x) ((x *) emalloc((a), sizeof(x)))
+#define FREE_IN(a, p) utilFree((a), (p), sizeof(*(p)))
 
 static void     initialize_list(Generic_list * list);
+static void     initialize_list_in(Generic_list * list,
+                                   const UtilAllocator * al);
 static void     initialize_sorted_list(Generic_list * list,
-                                       int (*lt) (void *a, void *b));
+                                       int (*lt) (void *a, void *b),
+                                       const UtilAllocator * al);
 static void     destroy_list(Generic_list * list);
 static void     add_to_beginning(Generic_list list, void *pointer);
 static void     add_to_end(Generic_list list, void *pointer);
@@ -88,14 +94,25 @@ static Generic_list copy_list(Generic_list list);
 
 static char    *module = "generic_list";
 
-static void    *emalloc(unsigned int n);
+static void    *emalloc(const UtilAllocator * al, unsigned int n);
 
 /****************************************************************************/
 
 static void
 initialize_list(Generic_list * list)
 {
-  list->info = NEW(Generic_list_info);
+  initialize_list_in(list, NULL);
+}
+
+/*
+ * the list and its elements are allocated by al, which may be NULL 
+ */
+static void
+initialize_list_in(Generic_list * list, const UtilAllocator * al)
+{
+  list->info = NEW_IN(al, Generic_list_info);
+  list->info->allocator = al;
+  list->info->memUnlink = NULL;
 
   list->info->pre_element.pointer = NULL;
   list->info->pre_element.previous = &list->info->pre_element;
@@ -113,9 +130,10 @@ initialize_list(Generic_list * list)
 /****************************************************************************/
 
 static void
-initialize_sorted_list(Generic_list * list, int (*lt) (void *a, void *b))
+initialize_sorted_list(Generic_list * list, int (*lt) (void *a, void *b),
+                       const UtilAllocator * al)
 {
-  initialize_list(list);
+  initialize_list_in(list, al);
   list->info->lt = lt;
 }
 
@@ -125,7 +143,7 @@ static void
 destroy_list(Generic_list * list)
 {
   remove_all(*list);
-  free((void *) list->info);
+  FREE_IN(list->info->allocator, list->info);
 }
 
 /****************************************************************************/
@@ -141,7 +159,7 @@ add_to_beginning(Generic_list list, void *pointer)
     exit(EXIT_FAILURE);
   }
 
-  element = NEW(Generic_list_element);
+  element = NEW_IN(list.info->allocator, Generic_list_element);
   element->next = list.info->pre_element.next;
   element->previous = &list.info->pre_element;
   element->pointer = pointer;
@@ -166,7 +184,7 @@ add_to_end(Generic_list list, void *pointer)
     exit(EXIT_FAILURE);
   }
 
-  element = NEW(Generic_list_element);
+  element = NEW_IN(list.info->allocator, Generic_list_element);
   element->next = &list.info->post_element;
   element->previous = list.info->post_element.previous;
   element->pointer = pointer;
@@ -224,7 +242,7 @@ remove_from_list(Generic_list list, void *pointer)
   element->previous->next = element->next;
   element->next->previous = element->previous;
 
-  free(element);
+  FREE_IN(list.info->allocator, element);
   list.info->num_of_elements--;
 
   return pointer;
@@ -249,7 +267,7 @@ remove_from_beginning(Generic_list list)
   list.info->pre_element.next = element->next;
   element->next->previous = &list.info->pre_element;
 
-  free(element);
+  FREE_IN(list.info->allocator, element);
   list.info->num_of_elements--;
 
   return pointer;
@@ -274,7 +292,7 @@ remove_from_end(Generic_list list)
   list.info->post_element.previous = element->previous;
   element->previous->next = &list.info->post_element;
 
-  free(element);
+  FREE_IN(list.info->allocator, element);
   list.info->num_of_elements--;
 
   return pointer;
@@ -300,7 +318,7 @@ remove_current(Generic_list list)
   element->next->previous = element->previous;
   element->previous->next = element->next;
 
-  free(element);
+  FREE_IN(list.info->allocator, element);
   list.info->num_of_elements--;
 
   return pointer;
@@ -317,7 +335,7 @@ remove_all(Generic_list list)
   while (element && element != &list.info->post_element) {
     element = element->next;
     if (element)
-      free(element->previous);
+      FREE_IN(list.info->allocator, element->previous);
   }
 
   list.info->pre_element.next = &list.info->post_element;
@@ -432,7 +450,7 @@ copy_list(Generic_list list)
   Generic_list    list_copy;
   Generic_list_element *element;
 
-  initialize_sorted_list(&list_copy, list.info->lt);
+  initialize_sorted_list(&list_copy, list.info->lt, list.info->allocator);
   element = list.info->pre_element.next;
   while (element != &list.info->post_element) {
     add_to_end(list_copy, element->pointer);
@@ -538,11 +556,11 @@ copy_list(Generic_list list)
 /****************************************************************************/
 
 static void    *
-emalloc(unsigned int n)
+emalloc(const UtilAllocator * al, unsigned int n)
 {
   void           *ptr;
 
-  ptr = (void *) malloc(n);
+  ptr = utilAlloc(al, n);
   if (ptr == NULL) {
     //    mlogf(M_ERROR, M_SHOW, "%s: error allocating memory\n", module);
     exit(EXIT_FAILURE);
@@ -554,8 +572,15 @@ static void
 listRelease(UtilList * ul)
 {
   Generic_list    l = *(Generic_list *) & ul->hdl;
+  const UtilAllocator *al = l.info->allocator;
+  void            (*memUnlink) (int) = l.info->memUnlink;
+  UTIL_FORGET(ul);
   destroy_list(&l);
-  if (ul->ft->memUnlink)  ul->ft->memUnlink(ul->mem_state);
+  if (al) {
+    FREE_IN(al, ul);
+    return;
+  }
+  if (memUnlink)  memUnlink(ul->mem_state);
   free(ul);
 }
 
@@ -563,7 +588,7 @@ static UtilList *
 listClone(UtilList * ul)
 {
   Generic_list    l = *(Generic_list *) & ul->hdl;
-  UtilList       *nul = NEW(UtilList);
+  UtilList       *nul = NEW_IN(l.info->allocator, UtilList);
   *nul = *ul;
   nul->hdl = copy_list(l).info;
   return nul;
@@ -686,7 +711,7 @@ Util_List_FT    UtilList_ft = {
   2,
   listRelease,
   //  listMemUnlink, /* should be set by SFCB */
-  NULL, /* memUnlink (used in SFCB) */
+  NULL, /* memUnlink, unused: the hook is kept per list, see newList() */
   listClone,
   listClear,
   listSize,
@@ -708,14 +733,21 @@ Util_List_FT    UtilList_ft = {
 
 Util_List_FT   *UtilListFT = &UtilList_ft;
 
+/*
+ * memReleaseFunc is stored with the list instead of in the shared
+ * UtilList_ft, so lists with different (or no) hooks can be created
+ * concurrently; clones never inherit it 
+ */
 UtilList       *
 newList(void* memAddFunc, void* memReleaseFunc)
 {
   UtilList        ul;
 
   ul.ft = UtilListFT;
+  ul.mem_state = 0;
   initialize_list((Generic_list *) & ul.hdl);
-  ul.ft->memUnlink = memReleaseFunc;
+  ((Generic_list *) & ul.hdl)->info->memUnlink =
+      (void (*)(int)) memReleaseFunc;
 
   if (memAddFunc) {  /* SFCB does this */
     UtilList* (*memLink)(UtilList*);
@@ -726,6 +758,27 @@ newList(void* memAddFunc, void* memReleaseFunc)
     return memcpy(malloc(sizeof(ul)),&ul,sizeof(ul));
   }
 }
+
+/*
+ * lists with an allocator are never handed to the memAdd/memRelease
+ * hooks, the allocator sees all of their memory instead 
+ */
+UtilList       *
+newListWithAllocator(const UtilAllocator * al)
+{
+  UtilList       *ul = NEW_IN(al, UtilList);
+
+  ul->ft = UtilListFT;
+  ul->mem_state = 0;
+  initialize_list_in((Generic_list *) & ul->hdl, al);
+  return ul;
+}
+
+UtilList       *
+newListInArena(UtilArena * arena)
+{
+  return newListWithAllocator(arenaAllocator(arena));
+}
 /* MODELINES */
 /* DO NOT EDIT BELOW THIS COMMENT */
 /* Modelines are added by 'make pretty' */
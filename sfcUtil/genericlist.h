@@ -37,6 +37,7 @@
 #define GENERIC_LIST_DEFINED
 
 #include "utilft.h"
+#include <stdlib.h>
 #include <string.h>
 
 typedef struct GLE_struct {
@@ -52,6 +53,8 @@ typedef struct {
                   deleted_element;
   int             (*lt) (void *a, void *b);
   unsigned int    num_of_elements;
+  const UtilAllocator *allocator;       /* NULL: malloc() */
+  void            (*memUnlink) (int mem_state);  /* see newList() */
 } Generic_list_info;
 
 typedef struct {
@@ -87,6 +90,124 @@ typedef struct {
 #define peek_at_tail peek_at_end
 #define copy_queue copy_list
 
+/****************************************************************************/
+
+/*
+ * Single producer/single consumer ring of pointers, for handing work
+ * from one pipeline stage (thread) to the next without a lock.  The
+ * producer owns tail, the consumer owns head; each keeps a cached copy
+ * of the other index on its own cache line and only reads the shared
+ * one when the cache says the ring is full or empty, so in steady state
+ * the two threads touch no common cache line but the slots.  Batch
+ * operations publish their index once per batch.  The rings are
+ * allocated by the caller, without any alignment guarantee, so every
+ * group of fields is separated from the next by a whole cache line of
+ * padding: two groups cannot share a line wherever the ring starts.
+ */
+
+#define GENERIC_CACHE_LINE 64
+
+typedef struct {
+  char            pad0[GENERIC_CACHE_LINE];
+  unsigned long   head;         /* next slot to pop */
+  unsigned long   tailCache;    /* consumer's view of tail */
+  char            pad1[GENERIC_CACHE_LINE];
+  unsigned long   tail;         /* next slot to push */
+  unsigned long   headCache;    /* producer's view of head */
+  char            pad2[GENERIC_CACHE_LINE];
+  unsigned long   mask;
+  void          **slots;
+  char            pad3[GENERIC_CACHE_LINE];
+} Generic_spsc_ring;
+
+/*
+ * capacity is rounded up to a power of two; returns 0 on success 
+ */
+static inline int
+initialize_spsc_ring(Generic_spsc_ring * ring, unsigned long capacity)
+{
+  unsigned long   n = 2;
+
+  while (n < capacity)
+    n <<= 1;
+  memset(ring, 0, sizeof(*ring));
+  ring->mask = n - 1;
+  ring->slots = (void **) malloc(n * sizeof(void *));
+  return ring->slots == NULL;
+}
+
+static inline void
+destroy_spsc_ring(Generic_spsc_ring * ring)
+{
+  free(ring->slots);
+  ring->slots = NULL;
+}
+
+/*
+ * producer side: pushes up to n pointers, returns how many fit 
+ */
+static inline unsigned long
+spsc_push_batch(Generic_spsc_ring * ring, void *const *p, unsigned long n)
+{
+  unsigned long   tail = ring->tail,
+      room = ring->mask + 1 - (tail - ring->headCache),
+      i;
+
+  if (room < n) {
+    ring->headCache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    room = ring->mask + 1 - (tail - ring->headCache);
+    if (room < n)
+      n = room;
+  }
+  for (i = 0; i < n; i++)
+    ring->slots[(tail + i) & ring->mask] = p[i];
+  __atomic_store_n(&ring->tail, tail + n, __ATOMIC_RELEASE);
+  return n;
+}
+
+/*
+ * consumer side: pops up to max pointers into p, returns how many 
+ */
+static inline unsigned long
+spsc_pop_batch(Generic_spsc_ring * ring, void **p, unsigned long max)
+{
+  unsigned long   head = ring->head,
+      avail = ring->tailCache - head,
+      i;
+
+  if (avail < max) {
+    ring->tailCache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    avail = ring->tailCache - head;
+    if (avail < max)
+      max = avail;
+  }
+  for (i = 0; i < max; i++)
+    p[i] = ring->slots[(head + i) & ring->mask];
+  __atomic_store_n(&ring->head, head + max, __ATOMIC_RELEASE);
+  return max;
+}
+
+/*
+ * returns 0 on success, 1 if the ring is full 
+ */
+static inline int
+spsc_push(Generic_spsc_ring * ring, void *pointer)
+{
+  return spsc_push_batch(ring, &pointer, 1) != 1;
+}
+
+/*
+ * returns NULL if the ring is empty 
+ */
+static inline void *
+spsc_pop(Generic_spsc_ring * ring)
+{
+  void           *pointer = NULL;
+
+  spsc_pop_batch(ring, &pointer, 1);
+  return pointer;
+}
+
 #endif                          /* GENERIC_LIST_DEFINED */
 /* MODELINES */
 /* DO NOT EDIT BELOW THIS COMMENT */
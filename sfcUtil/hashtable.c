@@ -30,11 +30,33 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <time.h>
 #include "hashtable.h"
 #include "utilft.h"
+#include "utilAlloc.h"
+#include "utilRegistry.h"
 
-#define NEW(x) ((x *) malloc(sizeof(x)))
+#define NEW(t, x) ((x *) utilAlloc((t)->allocator, sizeof(x)))
+
+/*
+ * operation counters, compiled in with -DHASHTABLE_STATS; lookups only
+ * read the table and may run concurrently, so the counters are bumped
+ * atomically.  STAT_PROBE() counts a pair a lookup passed over,
+ * STAT_PROBES() records the count once the lookup is done.
+ */
+#ifdef HASHTABLE_STATS
+#define STAT(t, field) \
+  ((void) __atomic_fetch_add(&(t)->stats->field, 1, __ATOMIC_RELAXED))
+#define STAT_PROBE(n) ((n)++)
+#define STAT_PROBES(t, n, found) countProbes((t), (n) + ((found) != NULL))
+static void     countProbes(const HashTable * hashTable, long n);
+#else
+#define STAT(t, field) ((void) 0)
+#define STAT_PROBE(n) ((void) 0)
+#define STAT_PROBES(t, n, found) ((void) (n))
+#endif
 
 static int      pointercmp(const void *pointer1, const void *pointer2);
 static unsigned long pointerHashFunction(const void *pointer);
@@ -47,13 +69,16 @@ static void     HashTableRehash(HashTable * hashTable, long numOfBuckets);
 /*--------------------------------------------------------------------------*\
  *  NAME:
  *      HashTableCreate() - creates a new HashTable
+ *      HashTableCreateWithAllocator() - the same with an allocator
  *  DESCRIPTION:
  *      Creates a new HashTable.  When finished with this HashTable, it
  *      should be explicitly destroyed by calling the HashTableDestroy()
- *      function.
+ *      function.  The table, its buckets and pairs are allocated from
+ *      the allocator al, or with malloc() if al is NULL.
  *  EFFICIENCY:
  *      O(1)
  *  ARGUMENTS:
+ *      al           - the allocator to use, may be NULL
  *      numOfBuckets - the number of buckets to start the HashTable out with.
  *                     Must be greater than zero, and should be prime.
  *                     Ideally, the number of buckets should between 1/5
@@ -72,23 +97,36 @@ static void     HashTableRehash(HashTable * hashTable, long numOfBuckets);
 \*--------------------------------------------------------------------------*/
 
 void           *
-HashTableCreate(long numOfBuckets)
+HashTableCreateWithAllocator(const UtilAllocator * al, long numOfBuckets)
 {
   HashTable      *hashTable;
   int             i;
 
   assert(numOfBuckets > 0);
 
-  hashTable = (HashTable *) malloc(sizeof(HashTable));
+  hashTable = (HashTable *) utilAlloc(al, sizeof(HashTable));
   if (hashTable == NULL)
     return NULL;
 
+  hashTable->allocator = al;
+  hashTable->stats = NULL;
   hashTable->bucketArray = (KeyValuePair **)
-      malloc(numOfBuckets * sizeof(KeyValuePair *));
+      utilAlloc(al, numOfBuckets * sizeof(KeyValuePair *));
   if (hashTable->bucketArray == NULL) {
-    free(hashTable);
+    utilFree(al, hashTable, sizeof(HashTable));
+    return NULL;
+  }
+#ifdef HASHTABLE_STATS
+  hashTable->stats = (UtilHashTableStats *)
+      utilAlloc(al, sizeof(UtilHashTableStats));
+  if (hashTable->stats == NULL) {
+    utilFree(al, hashTable->bucketArray,
+             numOfBuckets * sizeof(KeyValuePair *));
+    utilFree(al, hashTable, sizeof(HashTable));
     return NULL;
   }
+  memset(hashTable->stats, 0, sizeof(UtilHashTableStats));
+#endif
 
   hashTable->numOfBuckets = numOfBuckets;
   hashTable->numOfElements = 0;
@@ -109,6 +147,12 @@ HashTableCreate(long numOfBuckets)
   return hashTable;
 }
 
+void           *
+HashTableCreate(long numOfBuckets)
+{
+  return HashTableCreateWithAllocator(NULL, numOfBuckets);
+}
+
 /*--------------------------------------------------------------------------*\
  *  NAME:
  *      HashTableDestroy() - destroys an existing HashTable
@@ -135,13 +179,17 @@ HashTableDestroy(HashTable * hashTable)
         hashTable->keyDeallocator((void *) pair->key);
       if (hashTable->valueDeallocator != NULL)
         hashTable->valueDeallocator(pair->value);
-      free(pair);
+      utilFree(hashTable->allocator, pair, sizeof(KeyValuePair));
       pair = nextPair;
     }
   }
 
-  free(hashTable->bucketArray);
-  free(hashTable);
+  utilFree(hashTable->allocator, hashTable->bucketArray,
+           hashTable->numOfBuckets * sizeof(KeyValuePair *));
+  if (hashTable->stats)
+    utilFree(hashTable->allocator, hashTable->stats,
+             sizeof(UtilHashTableStats));
+  utilFree(hashTable->allocator, hashTable, sizeof(HashTable));
 }
 
 /*--------------------------------------------------------------------------*\
@@ -227,7 +275,8 @@ HashTableContainsValue(const HashTable * hashTable, const void *value)
 static int
 HashTablePut(HashTable * hashTable, const void *key, void *value)
 {
-  long            hashValue;
+  long            hashValue,
+                  probes = 0;
   KeyValuePair   *pair;
 
   assert(key != NULL);
@@ -236,8 +285,12 @@ HashTablePut(HashTable * hashTable, const void *key, void *value)
   hashValue = hashTable->hashFunction(key) % hashTable->numOfBuckets;
   pair = hashTable->bucketArray[hashValue];
 
-  while (pair != NULL && hashTable->keycmp(key, pair->key) != 0)
+  while (pair != NULL && hashTable->keycmp(key, pair->key) != 0) {
     pair = pair->next;
+    STAT_PROBE(probes);
+  }
+  STAT(hashTable, puts);
+  STAT_PROBES(hashTable, probes, pair);
 
   if (pair) {
     if (pair->key != key) {
@@ -251,8 +304,7 @@ HashTablePut(HashTable * hashTable, const void *key, void *value)
       pair->value = value;
     }
   } else {
-    KeyValuePair   *newPair =
-        (KeyValuePair *) malloc(sizeof(KeyValuePair));
+    KeyValuePair   *newPair = NEW(hashTable, KeyValuePair);
     if (newPair == NULL) {
       return -1;
     } else {
@@ -298,9 +350,16 @@ HashTableGet(const HashTable * hashTable, const void *key)
   long            hashValue =
       hashTable->hashFunction(key) % hashTable->numOfBuckets;
   KeyValuePair   *pair = hashTable->bucketArray[hashValue];
+  long            probes = 0;
 
-  while (pair != NULL && hashTable->keycmp(key, pair->key) != 0)
+  while (pair != NULL && hashTable->keycmp(key, pair->key) != 0) {
     pair = pair->next;
+    STAT_PROBE(probes);
+  }
+  STAT(hashTable, gets);
+  STAT_PROBES(hashTable, probes, pair);
+  if (pair)
+    STAT(hashTable, hits);
 
   return (pair == NULL) ? NULL : pair->value;
 }
@@ -328,11 +387,15 @@ HashTableRemove(HashTable * hashTable, const void *key)
       hashTable->hashFunction(key) % hashTable->numOfBuckets;
   KeyValuePair   *pair = hashTable->bucketArray[hashValue];
   KeyValuePair   *previousPair = NULL;
+  long            probes = 0;
 
   while (pair != NULL && hashTable->keycmp(key, pair->key) != 0) {
     previousPair = pair;
     pair = pair->next;
+    STAT_PROBE(probes);
   }
+  STAT(hashTable, removes);
+  STAT_PROBES(hashTable, probes, pair);
 
   if (pair != NULL) {
     if (hashTable->keyDeallocator != NULL)
@@ -343,7 +406,7 @@ HashTableRemove(HashTable * hashTable, const void *key)
       previousPair->next = pair->next;
     else
       hashTable->bucketArray[hashValue] = pair->next;
-    free(pair);
+    utilFree(hashTable->allocator, pair, sizeof(KeyValuePair));
     hashTable->numOfElements--;
 
     if (hashTable->lowerRehashThreshold > 0.0) {
@@ -383,7 +446,7 @@ HashTableRemoveAll(HashTable * hashTable)
         hashTable->keyDeallocator((void *) pair->key);
       if (hashTable->valueDeallocator != NULL)
         hashTable->valueDeallocator(pair->value);
-      free(pair);
+      utilFree(hashTable->allocator, pair, sizeof(KeyValuePair));
       pair = nextPair;
     }
     hashTable->bucketArray[i] = NULL;
@@ -574,6 +637,10 @@ HashTableRehash(HashTable * hashTable, long numOfBuckets)
 {
   KeyValuePair  **newBucketArray;
   int             i;
+#ifdef HASHTABLE_STATS
+  struct timespec start,
+                  end;
+#endif
 
   assert(numOfBuckets >= 0);
   if (numOfBuckets == 0)
@@ -583,7 +650,7 @@ HashTableRehash(HashTable * hashTable, long numOfBuckets)
     return;                     /* already the right size! */
 
   newBucketArray = (KeyValuePair **)
-      malloc(numOfBuckets * sizeof(KeyValuePair *));
+      utilAlloc(hashTable->allocator, numOfBuckets * sizeof(KeyValuePair *));
   if (newBucketArray == NULL) {
     /*
      * Couldn't allocate memory for the new array.  This isn't a fatal
@@ -592,6 +659,9 @@ HashTableRehash(HashTable * hashTable, long numOfBuckets)
     return;
   }
 
+#ifdef HASHTABLE_STATS
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
   for (i = 0; i < numOfBuckets; i++)
     newBucketArray[i] = NULL;
 
@@ -607,9 +677,16 @@ HashTableRehash(HashTable * hashTable, long numOfBuckets)
     }
   }
 
-  free(hashTable->bucketArray);
+  utilFree(hashTable->allocator, hashTable->bucketArray,
+           hashTable->numOfBuckets * sizeof(KeyValuePair *));
   hashTable->bucketArray = newBucketArray;
   hashTable->numOfBuckets = numOfBuckets;
+#ifdef HASHTABLE_STATS
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  STAT(hashTable, rehashes);
+  hashTable->stats->rehashSeconds += (end.tv_sec - start.tv_sec) +
+      (end.tv_nsec - start.tv_nsec) * 1e-9;
+#endif
 }
 
 /*--------------------------------------------------------------------------*\
@@ -703,6 +780,66 @@ HashTableSetDeallocationFunctions(HashTable * hashTable,
   hashTable->valueDeallocator = valueDeallocator;
 }
 
+/*--------------------------------------------------------------------------*\
+ *  NAME:
+ *      HashTableGetStats() - reports how well a HashTable is hashing
+ *  DESCRIPTION:
+ *      Fills in the size, number of used buckets and longest chain of the
+ *      specified HashTable and, when built with HASHTABLE_STATS, the
+ *      get/put/remove counts, hits, probe length histogram and rehash
+ *      count and time since it was created.  Tables whose lookups keep
+ *      landing in the upper probe buckets have a poor hash function.
+ *  EFFICIENCY:
+ *      O(n)
+ *  ARGUMENTS:
+ *      hashTable    - a HashTable
+ *      st           - receives the statistics
+ *  RETURNS:
+ *      int          - 0 if the counters are live, 1 if they are compiled
+ *                     out and zero
+\*--------------------------------------------------------------------------*/
+
+static int
+HashTableGetStats(const HashTable * hashTable, UtilHashTableStats * st)
+{
+  long            i,
+                  n;
+  KeyValuePair   *pair;
+#ifdef HASHTABLE_STATS
+  UtilHashTableStats *c = hashTable->stats;
+#endif
+
+  memset(st, 0, sizeof(UtilHashTableStats));
+#ifdef HASHTABLE_STATS
+  /*
+   * lookups may be counting concurrently 
+   */
+  st->gets = __atomic_load_n(&c->gets, __ATOMIC_RELAXED);
+  st->hits = __atomic_load_n(&c->hits, __ATOMIC_RELAXED);
+  st->puts = __atomic_load_n(&c->puts, __ATOMIC_RELAXED);
+  st->removes = __atomic_load_n(&c->removes, __ATOMIC_RELAXED);
+  st->rehashes = __atomic_load_n(&c->rehashes, __ATOMIC_RELAXED);
+  st->rehashSeconds = c->rehashSeconds;
+  for (i = 0; i < UtilHashTable_probeBuckets; i++)
+    st->probes[i] = __atomic_load_n(&c->probes[i], __ATOMIC_RELAXED);
+#endif
+  st->size = hashTable->numOfElements;
+  st->buckets = hashTable->numOfBuckets;
+  for (i = 0; i < hashTable->numOfBuckets; i++) {
+    for (n = 0, pair = hashTable->bucketArray[i]; pair; pair = pair->next)
+      n++;
+    if (n)
+      st->usedBuckets++;
+    if (n > st->longestChain)
+      st->longestChain = n;
+  }
+#ifdef HASHTABLE_STATS
+  return 0;
+#else
+  return 1;
+#endif
+}
+
 /*--------------------------------------------------------------------------*\
  *  NAME:
  *      HashTableStringHashFunction() - a good hash function for strings
@@ -731,6 +868,19 @@ pointercmp(const void *pointer1, const void *pointer2)
   return (pointer1 != pointer2);
 }
 
+#ifdef HASHTABLE_STATS
+/*
+ * records a lookup that looked at n pairs
+ */
+static void
+countProbes(const HashTable * hashTable, long n)
+{
+  if (n >= UtilHashTable_probeBuckets)
+    n = UtilHashTable_probeBuckets - 1;
+  __atomic_fetch_add(&hashTable->stats->probes[n], 1, __ATOMIC_RELAXED);
+}
+#endif
+
 static unsigned long
 pointerHashFunction(const void *pointer)
 {
@@ -774,8 +924,11 @@ NotSupported(UtilHashTable * ht)
 static void
 hashTableDestroy(UtilHashTable * ht)
 {
+  const UtilAllocator *al = ((HashTable *) ht->hdl)->allocator;
+
+  UTIL_FORGET(ht);
   HashTableDestroy((HashTable *) ht->hdl);
-  free(ht);
+  utilFree(al, ht, sizeof(UtilHashTable));
 }
 
 static void
@@ -842,7 +995,7 @@ static HashTableIterator *
 hashTableGetFirst(UtilHashTable * ht, void **key, void **val)
 {
   HashTable      *t = (HashTable *) ht->hdl;
-  HashTableIterator *iter = NEW(HashTableIterator);
+  HashTableIterator *iter = NEW(t, HashTableIterator);
   for (iter->bucket = 0; iter->bucket < t->numOfBuckets; iter->bucket++) {
     iter->pair = t->bucketArray[iter->bucket];
     if (iter->pair != NULL) {
@@ -851,7 +1004,7 @@ hashTableGetFirst(UtilHashTable * ht, void **key, void **val)
       return iter;
     }
   }
-  free(iter);
+  utilFree(t->allocator, iter, sizeof(HashTableIterator));
   return NULL;
 }
 
@@ -873,7 +1026,7 @@ hashTableGetNext(UtilHashTable * ht,
     *val = iter->pair->value;
     return iter;
   }
-  free(iter);
+  utilFree(t->allocator, iter, sizeof(HashTableIterator));
   return NULL;
 }
 
@@ -913,8 +1066,14 @@ hashTableSetDeallocationFunctions(UtilHashTable * ht,
   HashTableSetDeallocationFunctions(t, keyRelease, valueRelease);
 }
 
+static int
+hashTableGetStats(const UtilHashTable * ht, UtilHashTableStats * st)
+{
+  return HashTableGetStats((const HashTable *) ht->hdl, st);
+}
+
 static Util_HashTable_FT ift = {
-  1,
+  2,
   hashTableDestroy,             // release
   NotSupported,                 // clone
   hashTableRemoveAll,           // clear
@@ -935,6 +1094,7 @@ static Util_HashTable_FT ift = {
   hashTableSetValueComparisonFunction,  // setValueCmpFunction
   hashTableSetHashFunction,     // setHashFunction
   hashTableSetDeallocationFunctions,    // setReleaseFunctions
+  hashTableGetStats,            // stats
 };
 
 Util_HashTable_FT *UtilHashTableFT = &ift;
@@ -54,6 +54,9 @@ typedef struct {
   unsigned long   (*hashFunction) (const void *key);
   void            (*keyDeallocator) (void *key);
   void            (*valueDeallocator) (void *value);
+  const struct _UtilAllocator *allocator;      /* NULL: malloc() */
+  struct _UtilHashTableStats *stats;   /* NULL unless built with
+                                         * HASHTABLE_STATS */
 } HashTable;
 
 struct _HashTableIterator {
@@ -0,0 +1,56 @@
+
+/*
+ * utilAlloc.h
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Internal allocation interface of the sfcUtil containers.
+ *
+ */
+
+#ifndef _UTILALLOC_H_
+#define _UTILALLOC_H_
+
+#include <stdlib.h>
+#include "utilft.h"
+
+extern const UtilAllocator *arenaAllocator(UtilArena * a);
+
+/*
+ * containers created without an allocator use the C library; size is
+ * the size the block was allocated with
+ */
+static inline void *
+utilAlloc(const UtilAllocator * al, size_t size)
+{
+  return al ? al->alloc(al->ctx, size) : malloc(size);
+}
+
+static inline void *
+utilRealloc(const UtilAllocator * al, void *p, size_t oldSize, size_t size)
+{
+  return al ? al->realloc(al->ctx, p, oldSize, size) : realloc(p, size);
+}
+
+static inline void
+utilFree(const UtilAllocator * al, void *p, size_t size)
+{
+  if (al)
+    al->free(al->ctx, p, size);
+  else
+    free(p);
+}
+
+#endif                          /* _UTILALLOC_H_ */
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,231 @@
+
+/*
+ * utilArena.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Arena (bump) allocator for request scoped containers.
+ *
+ * Memory is carved out of large chunks and only given back to the
+ * C library when the arena is reset or released, so everything built
+ * for one request goes away with a single call.  Small freed blocks are
+ * kept on per size free lists and handed out again, which keeps
+ * containers with a lot of insert/remove traffic from growing the
+ * arena.  An arena is not locked: it belongs to one thread at a time,
+ * typically the one handling the request.
+ *
+ */
+
+#include "utilft.h"
+#include "utilAlloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+/*
+ * default chunk size
+ */
+#define ARENA_CHUNK (64 * 1024)
+
+/*
+ * blocks up to ARENA_CLASSES * ARENA_ALIGN bytes are recycled
+ */
+#define ARENA_CLASSES 16
+
+typedef struct _ArenaChunk {
+  struct _ArenaChunk *next;
+  size_t          size;         /* usable bytes */
+} ArenaChunk;
+
+#define CHUNK_HEADER ARENA_ROUND(sizeof(ArenaChunk))
+#define CHUNK_DATA(c) ((char *) (c) + CHUNK_HEADER)
+
+struct _UtilArena {
+  ArenaChunk     *chunks;       /* the current chunk comes first */
+  char           *cur,
+                 *end;          /* free space of the current chunk */
+  char           *last;         /* latest bump allocation, may grow in
+                                 * place */
+  size_t          chunkSize;
+  void           *spare[ARENA_CLASSES];
+  UtilAllocator   allocator;    /* ctx is the arena */
+};
+
+static ArenaChunk *
+newChunk(size_t size)
+{
+  ArenaChunk     *c = (ArenaChunk *) malloc(CHUNK_HEADER + size);
+
+  if (c) {
+    c->next = NULL;
+    c->size = size;
+  }
+  return c;
+}
+
+static void    *
+arenaAlloc(void *ctx, size_t size)
+{
+  UtilArena      *a = (UtilArena *) ctx;
+  size_t          n = ARENA_ROUND(size ? size : 1);
+  ArenaChunk     *c;
+  char           *p;
+
+  if (n <= ARENA_CLASSES * ARENA_ALIGN && a->spare[n / ARENA_ALIGN - 1]) {
+    p = a->spare[n / ARENA_ALIGN - 1];
+    a->spare[n / ARENA_ALIGN - 1] = *(void **) p;
+    return p;
+  }
+
+  if (a->cur == NULL || (size_t) (a->end - a->cur) < n) {
+    if (n > a->chunkSize / 4) {
+      /*
+       * large blocks get a chunk of their own, which leaves the free
+       * space of the current chunk for the small ones
+       */
+      if ((c = newChunk(n)) == NULL)
+        return NULL;
+      if (a->chunks) {
+        c->next = a->chunks->next;
+        a->chunks->next = c;
+      } else
+        a->chunks = c;
+      return CHUNK_DATA(c);
+    }
+    if ((c = newChunk(a->chunkSize)) == NULL)
+      return NULL;
+    c->next = a->chunks;
+    a->chunks = c;
+    a->cur = CHUNK_DATA(c);
+    a->end = a->cur + c->size;
+  }
+
+  p = a->cur;
+  a->cur += n;
+  a->last = p;
+  return p;
+}
+
+static void
+arenaFree(void *ctx, void *p, size_t size)
+{
+  UtilArena      *a = (UtilArena *) ctx;
+  size_t          n = ARENA_ROUND(size ? size : 1);
+
+  if (p == NULL)
+    return;
+  if (p == a->last && (char *) p + n == a->cur) {
+    a->cur = a->last;
+    a->last = NULL;
+  } else if (n <= ARENA_CLASSES * ARENA_ALIGN) {
+    *(void **) p = a->spare[n / ARENA_ALIGN - 1];
+    a->spare[n / ARENA_ALIGN - 1] = p;
+  }
+  /*
+   * anything else stays allocated until the arena is reset
+   */
+}
+
+static void    *
+arenaRealloc(void *ctx, void *p, size_t oldSize, size_t size)
+{
+  UtilArena      *a = (UtilArena *) ctx;
+  size_t          o = ARENA_ROUND(oldSize ? oldSize : 1),
+      n = ARENA_ROUND(size ? size : 1);
+  void           *np;
+
+  if (p == NULL)
+    return arenaAlloc(a, size);
+  if (n <= o)
+    return p;
+  if (p == a->last && (char *) p + o == a->cur
+      && (size_t) (a->end - (char *) p) >= n) {
+    a->cur = (char *) p + n;
+    return p;
+  }
+  if ((np = arenaAlloc(a, size)) == NULL)
+    return NULL;
+  memcpy(np, p, oldSize);
+  arenaFree(a, p, oldSize);
+  return np;
+}
+
+UtilArena      *
+newArena(unsigned long chunkSize)
+{
+  UtilArena      *a = (UtilArena *) calloc(1, sizeof(UtilArena));
+
+  if (a) {
+    a->chunkSize = chunkSize ? ARENA_ROUND(chunkSize) : ARENA_CHUNK;
+    a->allocator.alloc = arenaAlloc;
+    a->allocator.realloc = arenaRealloc;
+    a->allocator.free = arenaFree;
+    a->allocator.ctx = a;
+  }
+  return a;
+}
+
+/*
+ * hands the arena to anything taking a UtilAllocator 
+ */
+const UtilAllocator *
+arenaAllocator(UtilArena * a)
+{
+  return &a->allocator;
+}
+
+/*
+ * frees everything allocated from the arena, but keeps one chunk for
+ * the next request
+ */
+void
+resetArena(UtilArena * a)
+{
+  ArenaChunk     *c = a->chunks,
+      *next,
+      *keep = NULL;
+
+  for (; c; c = next) {
+    next = c->next;
+    if (keep == NULL && c->size == a->chunkSize) {
+      keep = c;
+      keep->next = NULL;
+    } else
+      free(c);
+  }
+  a->chunks = keep;
+  a->cur = keep ? CHUNK_DATA(keep) : NULL;
+  a->end = keep ? a->cur + keep->size : NULL;
+  a->last = NULL;
+  memset(a->spare, 0, sizeof(a->spare));
+}
+
+void
+releaseArena(UtilArena * a)
+{
+  ArenaChunk     *c,
+                 *next;
+
+  if (a == NULL)
+    return;
+  for (c = a->chunks; c; c = next) {
+    next = c->next;
+    free(c);
+  }
+  free(a);
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,213 @@
+
+/*
+ * utilDeque.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Chase-Lev work-stealing deque of pointers.
+ *
+ * One owner thread pushes and pops at the bottom, any number of thieves
+ * steal from the top (D. Chase, Y. Lev, "Dynamic Circular Work-Stealing
+ * Deque", SPAA 2005, with the C11 memory orders of N. M. Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP
+ * 2013).  The circular array doubles when full; thieves may still be
+ * reading a replaced array, so replaced arrays are only freed by
+ * release.
+ *
+ */
+
+#include "utilft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+#define DEQUE_INITIAL 64
+
+typedef struct _DequeArray {
+  long            size;         /* a power of two */
+  struct _DequeArray *replaced; /* older arrays, freed by release */
+  void           *buf[1];
+} DequeArray;
+
+typedef struct {
+  long            top;
+  char            pad1[CACHE_LINE - sizeof(long)];
+  long            bottom;
+  char            pad2[CACHE_LINE - sizeof(long)];
+  DequeArray     *array;
+} Deque;
+
+#define SLOT(a, i) (&(a)->buf[(i) & ((a)->size - 1)])
+
+static DequeArray *
+newArray(long size)
+{
+  DequeArray     *a = (DequeArray *) malloc(sizeof(DequeArray) +
+                                            (size - 1) * sizeof(void *));
+
+  if (a) {
+    a->size = size;
+    a->replaced = NULL;
+  }
+  return a;
+}
+
+/*
+ * owner only: 0 on success, 1 if out of memory
+ */
+static int
+dequePush(UtilDeque * dq, void *elm)
+{
+  Deque          *d = (Deque *) dq->hdl;
+  long            b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED),
+      t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE),
+      i;
+  DequeArray     *a = __atomic_load_n(&d->array, __ATOMIC_RELAXED);
+
+  if (b - t > a->size - 1) {
+    DequeArray     *na = newArray(a->size * 2);
+
+    if (na == NULL)
+      return 1;
+    for (i = t; i < b; i++)
+      *SLOT(na, i) = __atomic_load_n(SLOT(a, i), __ATOMIC_RELAXED);
+    na->replaced = a;
+    __atomic_store_n(&d->array, na, __ATOMIC_RELEASE);
+    a = na;
+  }
+  __atomic_store_n(SLOT(a, b), elm, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  return 0;
+}
+
+/*
+ * owner only: the most recently pushed element, NULL if empty
+ */
+static void    *
+dequePop(UtilDeque * dq)
+{
+  Deque          *d = (Deque *) dq->hdl;
+  long            b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1,
+      t;
+  DequeArray     *a = __atomic_load_n(&d->array, __ATOMIC_RELAXED);
+  void           *elm = NULL;
+
+  __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+  if (t <= b) {
+    elm = __atomic_load_n(SLOT(a, b), __ATOMIC_RELAXED);
+    if (t == b) {
+      /*
+       * the last element, race the thieves for it
+       */
+      if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        elm = NULL;
+      __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+  } else
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+  return elm;
+}
+
+/*
+ * any thread: the oldest element, NULL if empty
+ */
+static void    *
+dequeSteal(UtilDeque * dq)
+{
+  Deque          *d = (Deque *) dq->hdl;
+
+  for (;;) {
+    long            t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE),
+        b;
+    DequeArray     *a;
+    void           *elm;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b)
+      return NULL;
+    a = __atomic_load_n(&d->array, __ATOMIC_ACQUIRE);
+    elm = __atomic_load_n(SLOT(a, t), __ATOMIC_RELAXED);
+    if (__atomic_compare_exchange_n(&d->top, &t, t + 1, 0,
+                                    __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+      return elm;
+    /*
+     * lost against another thief or the owner, look again
+     */
+  }
+}
+
+static int
+dequeIsEmpty(UtilDeque * dq)
+{
+  Deque          *d = (Deque *) dq->hdl;
+
+  return __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE) <=
+      __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+}
+
+static void
+dequeRelease(UtilDeque * dq)
+{
+  Deque          *d = (Deque *) dq->hdl;
+  DequeArray     *a,
+                 *next;
+
+  for (a = d->array; a; a = next) {
+    next = a->replaced;
+    free(a);
+  }
+  free(d);
+  free(dq);
+}
+
+static Util_Deque_FT dft = {
+  1,
+  dequeRelease,
+  dequePush,
+  dequePop,
+  dequeSteal,
+  dequeIsEmpty
+};
+
+UtilDeque      *
+newDeque(void)
+{
+  UtilDeque      *dq = (UtilDeque *) malloc(sizeof(UtilDeque));
+  void           *hdl = NULL;
+  Deque          *d;
+
+  if (dq == NULL)
+    return NULL;
+  if (posix_memalign(&hdl, CACHE_LINE, sizeof(Deque)) != 0) {
+    free(dq);
+    return NULL;
+  }
+  d = (Deque *) hdl;
+  memset(d, 0, sizeof(Deque));
+  if ((d->array = newArray(DEQUE_INITIAL)) == NULL) {
+    free(d);
+    free(dq);
+    return NULL;
+  }
+  dq->hdl = d;
+  dq->ft = &dft;
+  return dq;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -30,13 +30,49 @@ extern UtilHashTable *newHashTable(long buckets, long opt);
 extern UtilHashTable *newHashTableDefault(long buckets);
 extern UtilList *newList(); /*  coming from genericlist */
 extern UtilStringBuffer *newStringBuffer(int s);
+extern UtilArena *newArena(unsigned long chunkSize);
+extern void     resetArena(UtilArena * a);
+extern void     releaseArena(UtilArena * a);
+extern UtilHashTable *newHashTableInArena(UtilArena * a, long buckets,
+                                          long opt);
+extern UtilList *newListInArena(UtilArena * a);
+extern UtilStringBuffer *newStringBufferInArena(UtilArena * a, int s);
+extern UtilHashTable *newHashTableWithAllocator(const UtilAllocator * al,
+                                                long buckets, long opt);
+extern UtilList *newListWithAllocator(const UtilAllocator * al);
+extern UtilStringBuffer *newStringBufferWithAllocator(const UtilAllocator *
+                                                      al, int s);
+extern const UtilAllocator *arenaAllocator(UtilArena * a);
+extern UtilQueue *newQueue(unsigned long capacity);
+extern UtilDeque *newDeque(void);
+extern UtilThreadPool *newThreadPool(int threads);
+extern int      registerContainer(void *container, int kind,
+                                  const char *name);
+extern void     sampleContainers(void);
+extern void     dumpContainers(UtilStringBuffer * sb);
 
 static Util_Factory_FT ift = {
-  1,
+  6,
   newHashTableDefault,
   newHashTable,
   newList,
-  newStringBuffer
+  newStringBuffer,
+  newArena,
+  resetArena,
+  releaseArena,
+  newHashTableInArena,
+  newListInArena,
+  newStringBufferInArena,
+  newHashTableWithAllocator,
+  newListWithAllocator,
+  newStringBufferWithAllocator,
+  arenaAllocator,
+  newQueue,
+  newDeque,
+  newThreadPool,
+  registerContainer,
+  sampleContainers,
+  dumpContainers
 };
 
 Util_Factory_FT *UtilFactory = &ift;
@@ -24,8 +24,10 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include "utilAlloc.h"
 
-extern void    *HashTableCreate(long numOfBuckets);
+extern void    *HashTableCreateWithAllocator(const UtilAllocator * al,
+                                             long numOfBuckets);
 extern Util_HashTable_FT *UtilHashTableFT;
 
 static unsigned long
@@ -111,7 +113,7 @@ UtilHashTable  *
 newHashTableDefault(long buckets)
 {
   UtilHashTable  *ht = (UtilHashTable *) malloc(sizeof(UtilHashTable));
-  void           *t = HashTableCreate(buckets);
+  void           *t = HashTableCreateWithAllocator(NULL, buckets);
   ht->hdl = t;
   ht->ft = UtilHashTableFT;
 
@@ -123,11 +125,16 @@ newHashTableDefault(long buckets)
   return ht;
 }
 
+/*
+ * the table and all of its pairs and buckets are allocated by al, which
+ * may be NULL 
+ */
 UtilHashTable  *
-newHashTable(long buckets, long opt)
+newHashTableWithAllocator(const UtilAllocator * al, long buckets, long opt)
 {
-  UtilHashTable  *ht = (UtilHashTable *) malloc(sizeof(UtilHashTable));
-  void           *t = HashTableCreate(buckets);
+  UtilHashTable  *ht =
+      (UtilHashTable *) utilAlloc(al, sizeof(UtilHashTable));
+  void           *t = HashTableCreateWithAllocator(al, buckets);
   void            (*keyRelease) (void *key) = NULL;
   void            (*valueRelease) (void *value) = NULL;
 
@@ -179,6 +186,18 @@ newHashTable(long buckets, long opt)
 
   return ht;
 }
+
+UtilHashTable  *
+newHashTable(long buckets, long opt)
+{
+  return newHashTableWithAllocator(NULL, buckets, opt);
+}
+
+UtilHashTable  *
+newHashTableInArena(UtilArena * arena, long buckets, long opt)
+{
+  return newHashTableWithAllocator(arenaAllocator(arena), buckets, opt);
+}
 /* MODELINES */
 /* DO NOT EDIT BELOW THIS COMMENT */
 /* Modelines are added by 'make pretty' */
@@ -0,0 +1,459 @@
+
+/*
+ * utilQueue.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Lock-free multi-producer/multi-consumer queues of pointers.
+ *
+ * The bounded queue is D. Vyukov's array ring: every cell carries a
+ * sequence number telling producers and consumers whose turn it is, so
+ * a slot is claimed with one compare-and-swap on the head or tail
+ * counter.
+ *
+ * The unbounded queue is a linked list of fixed size segments (the
+ * FAA array queue of P. Ramalhete and A. Correia).  Producers and
+ * consumers claim slots with fetch-and-add; a consumer arriving at a
+ * slot before its producer poisons it, and the producer retries at the
+ * next one.  Drained segments are reclaimed with two epoch counters:
+ * a segment unlinked in epoch e is freed once the epoch reached e + 2,
+ * when no operation that could still see it is running.
+ *
+ * NULL cannot be queued, removeFirst() returns NULL for an empty queue.
+ *
+ */
+
+#include "utilft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_LINE 64
+
+/*
+ * slots per segment of the unbounded queue
+ */
+#define SEG_SIZE 1024
+
+#define LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define CAS(p, e, v) \
+  __atomic_compare_exchange_n((p), (e), (v), 0, __ATOMIC_SEQ_CST, \
+                              __ATOMIC_SEQ_CST)
+#define FAA(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+
+/****************************************************************************/
+
+typedef struct {
+  unsigned long   seq;
+  void           *data;
+} RingCell;
+
+typedef struct {
+  unsigned long   enq;
+  char            pad1[CACHE_LINE - sizeof(unsigned long)];
+  unsigned long   deq;
+  char            pad2[CACHE_LINE - sizeof(unsigned long)];
+  unsigned long   mask;
+  RingCell       *cells;
+} Ring;
+
+static int
+ringEnqueue(UtilQueue * q, void *elm)
+{
+  Ring           *r = (Ring *) q->hdl;
+  unsigned long   pos = __atomic_load_n(&r->enq, __ATOMIC_RELAXED);
+  RingCell       *c;
+
+  if (elm == NULL)
+    return 1;
+  for (;;) {
+    long            dif;
+
+    c = &r->cells[pos & r->mask];
+    dif = (long) (LOAD(&c->seq) - pos);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&r->enq, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0)
+      return 1;                 /* full */
+    else
+      pos = __atomic_load_n(&r->enq, __ATOMIC_RELAXED);
+  }
+  c->data = elm;
+  STORE(&c->seq, pos + 1);
+  return 0;
+}
+
+static void    *
+ringDequeue(UtilQueue * q)
+{
+  Ring           *r = (Ring *) q->hdl;
+  unsigned long   pos = __atomic_load_n(&r->deq, __ATOMIC_RELAXED);
+  RingCell       *c;
+  void           *elm;
+
+  for (;;) {
+    long            dif;
+
+    c = &r->cells[pos & r->mask];
+    dif = (long) (LOAD(&c->seq) - (pos + 1));
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&r->deq, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        break;
+    } else if (dif < 0)
+      return NULL;              /* empty */
+    else
+      pos = __atomic_load_n(&r->deq, __ATOMIC_RELAXED);
+  }
+  elm = c->data;
+  STORE(&c->seq, pos + r->mask + 1);
+  return elm;
+}
+
+static int
+ringIsEmpty(UtilQueue * q)
+{
+  Ring           *r = (Ring *) q->hdl;
+
+  return LOAD(&r->deq) >= LOAD(&r->enq);
+}
+
+static unsigned long
+ringCapacity(UtilQueue * q)
+{
+  return ((Ring *) q->hdl)->mask + 1;
+}
+
+static void
+ringRelease(UtilQueue * q)
+{
+  Ring           *r = (Ring *) q->hdl;
+
+  free(r->cells);
+  free(r);
+  free(q);
+}
+
+/****************************************************************************/
+
+typedef struct _Segment {
+  unsigned long   deq;
+  char            pad1[CACHE_LINE - sizeof(unsigned long)];
+  unsigned long   enq;
+  char            pad2[CACHE_LINE - sizeof(unsigned long)];
+  struct _Segment *next;
+  struct _Segment *retiredNext;
+  unsigned long   retiredEpoch;
+  void           *items[SEG_SIZE];
+} Segment;
+
+typedef struct {
+  Segment        *head;
+  char            pad1[CACHE_LINE - sizeof(Segment *)];
+  Segment        *tail;
+  char            pad2[CACHE_LINE - sizeof(Segment *)];
+  unsigned long   epoch;
+  unsigned long   active[2];    /* running operations by epoch parity */
+  Segment        *retired;
+  int             reclaiming;
+} SegQueue;
+
+/*
+ * marks a slot its consumer got to before the producer
+ */
+static char     taken;
+#define TAKEN ((void *) &taken)
+
+static Segment *
+newSegment(void *first)
+{
+  Segment        *s = (Segment *) calloc(1, sizeof(Segment));
+
+  if (s && first) {
+    s->items[0] = first;
+    s->enq = 1;
+  }
+  return s;
+}
+
+static unsigned long
+enter(SegQueue * sq)
+{
+  for (;;) {
+    unsigned long   e = LOAD(&sq->epoch);
+
+    FAA(&sq->active[e & 1], 1);
+    if (LOAD(&sq->epoch) == e)
+      return e;
+    FAA(&sq->active[e & 1], -1);
+  }
+}
+
+static void
+leave(SegQueue * sq, unsigned long e)
+{
+  FAA(&sq->active[e & 1], -1);
+}
+
+/*
+ * frees the retired segments no operation can see any more; one
+ * consumer at a time, the others leave it for the next call
+ */
+static void
+reclaim(SegQueue * sq)
+{
+  unsigned long   e = LOAD(&sq->epoch);
+  Segment        *s,
+                 *next,
+                 *keep = NULL;
+  int             busy = 0;
+
+  if (!CAS(&sq->reclaiming, &busy, 1))
+    return;
+  /*
+   * nothing of epoch e - 1 is running: move on to e + 1
+   */
+  if (LOAD(&sq->active[(e + 1) & 1]) == 0 && CAS(&sq->epoch, &e, e + 1))
+    e++;
+
+  s = __atomic_exchange_n(&sq->retired, NULL, __ATOMIC_SEQ_CST);
+  for (; s; s = next) {
+    next = s->retiredNext;
+    if (s->retiredEpoch + 2 <= e)
+      free(s);
+    else {
+      s->retiredNext = keep;
+      keep = s;
+    }
+  }
+  while (keep) {
+    next = keep->retiredNext;
+    keep->retiredNext = LOAD(&sq->retired);
+    while (!CAS(&sq->retired, &keep->retiredNext, keep));
+    keep = next;
+  }
+  STORE(&sq->reclaiming, 0);
+}
+
+static void
+retire(SegQueue * sq, Segment * s)
+{
+  s->retiredEpoch = LOAD(&sq->epoch);
+  s->retiredNext = LOAD(&sq->retired);
+  while (!CAS(&sq->retired, &s->retiredNext, s));
+  reclaim(sq);
+}
+
+static int
+segEnqueue(UtilQueue * q, void *elm)
+{
+  SegQueue       *sq = (SegQueue *) q->hdl;
+  unsigned long   e;
+
+  if (elm == NULL)
+    return 1;
+  e = enter(sq);
+  for (;;) {
+    Segment        *s = LOAD(&sq->tail),
+        *next;
+    unsigned long   i = FAA(&s->enq, 1);
+    void           *empty = NULL;
+
+    if (i >= SEG_SIZE) {
+      if (s != LOAD(&sq->tail))
+        continue;
+      next = LOAD(&s->next);
+      if (next == NULL) {
+        Segment        *ns = newSegment(elm);
+
+        if (ns == NULL) {
+          leave(sq, e);
+          return 1;
+        }
+        if (CAS(&s->next, &next, ns)) {
+          CAS(&sq->tail, &s, ns);
+          break;
+        }
+        free(ns);               /* never published */
+      } else
+        CAS(&sq->tail, &s, next);
+      continue;
+    }
+    if (CAS(&s->items[i], &empty, elm))
+      break;
+  }
+  leave(sq, e);
+  return 0;
+}
+
+static void    *
+segDequeue(UtilQueue * q)
+{
+  SegQueue       *sq = (SegQueue *) q->hdl;
+  unsigned long   e = enter(sq);
+  void           *elm = NULL;
+
+  for (;;) {
+    Segment        *s = LOAD(&sq->head),
+        *next;
+    unsigned long   i;
+
+    if (LOAD(&s->deq) >= LOAD(&s->enq) && LOAD(&s->next) == NULL)
+      break;                    /* empty */
+    i = FAA(&s->deq, 1);
+    if (i >= SEG_SIZE) {
+      Segment        *t = s;
+
+      if ((next = LOAD(&s->next)) == NULL)
+        break;
+      /*
+       * the tail must not lag behind the head
+       */
+      CAS(&sq->tail, &t, next);
+      if (CAS(&sq->head, &s, next)) {
+        leave(sq, e);
+        retire(sq, s);
+        e = enter(sq);
+      }
+      continue;
+    }
+    elm = __atomic_exchange_n(&s->items[i], TAKEN, __ATOMIC_SEQ_CST);
+    if (elm != NULL)
+      break;
+    /*
+     * the producer of slot i has not been here yet, it will retry
+     */
+  }
+  leave(sq, e);
+  return elm;
+}
+
+static int
+segIsEmpty(UtilQueue * q)
+{
+  SegQueue       *sq = (SegQueue *) q->hdl;
+  unsigned long   e = enter(sq);
+  Segment        *s = LOAD(&sq->head);
+  int             rc = LOAD(&s->deq) >= LOAD(&s->enq)
+      && LOAD(&s->next) == NULL;
+
+  leave(sq, e);
+  return rc;
+}
+
+static unsigned long
+segCapacity(UtilQueue * q)
+{
+  return 0;
+}
+
+/*
+ * no other thread may use the queue any more
+ */
+static void
+segRelease(UtilQueue * q)
+{
+  SegQueue       *sq = (SegQueue *) q->hdl;
+  Segment        *s,
+                 *next;
+
+  for (s = sq->head; s; s = next) {
+    next = s->next;
+    free(s);
+  }
+  for (s = sq->retired; s; s = next) {
+    next = s->retiredNext;
+    free(s);
+  }
+  free(sq);
+  free(q);
+}
+
+/****************************************************************************/
+
+static Util_Queue_FT ringFt = {
+  1,
+  ringRelease,
+  ringEnqueue,
+  ringDequeue,
+  ringIsEmpty,
+  ringCapacity
+};
+
+static Util_Queue_FT segFt = {
+  1,
+  segRelease,
+  segEnqueue,
+  segDequeue,
+  segIsEmpty,
+  segCapacity
+};
+
+/*
+ * capacity 0 creates an unbounded queue, any other capacity is rounded
+ * up to a power of two
+ */
+UtilQueue      *
+newQueue(unsigned long capacity)
+{
+  UtilQueue      *q = (UtilQueue *) malloc(sizeof(UtilQueue));
+  void           *hdl = NULL;
+
+  if (q == NULL)
+    return NULL;
+
+  if (capacity) {
+    Ring           *r;
+    unsigned long   n = 2,
+        i;
+
+    while (n < capacity)
+      n <<= 1;
+    if (posix_memalign(&hdl, CACHE_LINE, sizeof(Ring)) == 0) {
+      r = (Ring *) hdl;
+      memset(r, 0, sizeof(Ring));
+      r->mask = n - 1;
+      if ((r->cells = (RingCell *) malloc(n * sizeof(RingCell))) == NULL) {
+        free(r);
+        hdl = NULL;
+      } else
+        for (i = 0; i < n; i++)
+          r->cells[i].seq = i;
+    }
+    q->ft = &ringFt;
+  } else {
+    SegQueue       *sq;
+
+    if (posix_memalign(&hdl, CACHE_LINE, sizeof(SegQueue)) == 0) {
+      sq = (SegQueue *) hdl;
+      memset(sq, 0, sizeof(SegQueue));
+      if ((sq->head = sq->tail = newSegment(NULL)) == NULL) {
+        free(sq);
+        hdl = NULL;
+      }
+    }
+    q->ft = &segFt;
+  }
+
+  if (hdl == NULL) {
+    free(q);
+    return NULL;
+  }
+  q->hdl = hdl;
+  return q;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
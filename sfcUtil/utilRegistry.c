@@ -0,0 +1,263 @@
+
+/*
+ * utilRegistry.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Registry of live containers.
+ *
+ * Hash tables, lists and string buffers registered under a name are
+ * tracked until they are released.  Containers registered under the
+ * same name and kind (say every "instanceCache" table) are summed up:
+ * dumpContainers() reports, per name, how many are alive, their
+ * elements and bytes, and the highest totals seen so far.
+ *
+ * The totals are sampled, by sampleContainers() and on every dump, so
+ * the high-water marks are those of the samples; nothing is added to
+ * the container operations themselves.  Sampling reads the containers
+ * without locking them: run it where they are not being modified, or
+ * take the figures as approximate.
+ *
+ * Only malloc() backed containers can be registered, containers with an
+ * allocator may go away with their arena without being released.
+ *
+ */
+
+#include "utilft.h"
+#include "hashtable.h"
+#include "genericlist.h"
+#include "utilRegistry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+extern UtilHashTable *newHashTable(long buckets, long opt);
+
+typedef struct _Tag {
+  struct _Tag    *next;
+  char           *name;
+  int             kind;
+  long            live,
+                  elements,
+                  peakElements;
+  unsigned long   bytes,
+                  peakBytes;
+} Tag;
+
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+static Tag     *tags;
+static UtilHashTable *liveContainers;   /* container -> Tag */
+
+int             registryInUse = 0;
+
+static const char *kindNames[] = {
+  NULL, "hashtable", "list", "stringbuffer"
+};
+
+static int
+hasAllocator(void *c, int kind)
+{
+  switch (kind) {
+  case UtilRegistry_hashTable:
+    return ((HashTable *) ((UtilHashTable *) c)->hdl)->allocator != NULL;
+  case UtilRegistry_list:
+    return ((Generic_list_info *) ((UtilList *) c)->hdl)->allocator !=
+        NULL;
+  case UtilRegistry_stringBuffer:
+    return ((UtilStringBuffer *) c)->allocator != NULL;
+  }
+  return 1;
+}
+
+static void
+measure(void *c, int kind, long *elements, unsigned long *bytes)
+{
+  UtilHashTable  *ht;
+  UtilList       *ul;
+  UtilStringBuffer *sb;
+  long            n;
+
+  switch (kind) {
+  case UtilRegistry_hashTable:
+    ht = (UtilHashTable *) c;
+    n = ht->ft->size(ht);
+    *elements += n;
+    *bytes += sizeof(UtilHashTable) + sizeof(HashTable) +
+        ht->ft->buckets(ht) * sizeof(KeyValuePair *) +
+        n * sizeof(KeyValuePair);
+    break;
+  case UtilRegistry_list:
+    ul = (UtilList *) c;
+    n = ul->ft->size(ul);
+    *elements += n;
+    *bytes += sizeof(UtilList) + sizeof(Generic_list_info) +
+        n * sizeof(Generic_list_element);
+    break;
+  case UtilRegistry_stringBuffer:
+    sb = (UtilStringBuffer *) c;
+    *elements += sb->len;
+    *bytes += sizeof(UtilStringBuffer) + sb->max;
+    break;
+  }
+}
+
+static void
+sampleLocked(void)
+{
+  HashTableIterator *it;
+  void           *c;
+  Tag            *t;
+
+  for (t = tags; t; t = t->next)
+    t->elements = t->bytes = 0;
+  if (liveContainers)
+    for (it = liveContainers->ft->getFirst(liveContainers, &c, (void **) &t);
+         it;
+         it = liveContainers->ft->getNext(liveContainers, it, &c,
+                                          (void **) &t))
+      measure(c, t->kind, &t->elements, &t->bytes);
+  for (t = tags; t; t = t->next) {
+    if (t->elements > t->peakElements)
+      t->peakElements = t->elements;
+    if (t->bytes > t->peakBytes)
+      t->peakBytes = t->bytes;
+  }
+}
+
+/*
+ * kind is one of the UtilRegistry_ values; a container registered again
+ * moves to the new name.  0 on success, 1 if the container has an
+ * allocator or memory ran out
+ */
+int
+registerContainer(void *container, int kind, const char *name)
+{
+  Tag            *t,
+                 *old;
+
+  if (container == NULL || name == NULL || kind < UtilRegistry_hashTable
+      || kind > UtilRegistry_stringBuffer || hasAllocator(container, kind))
+    return 1;
+
+  pthread_mutex_lock(&registryLock);
+  if (liveContainers == NULL
+      && (liveContainers = newHashTable(61, 0)) == NULL)
+    goto nomem;
+  for (t = tags; t; t = t->next)
+    if (t->kind == kind && strcmp(t->name, name) == 0)
+      break;
+  if (t == NULL) {
+    if ((t = (Tag *) calloc(1, sizeof(Tag))) == NULL)
+      goto nomem;
+    if ((t->name = strdup(name)) == NULL) {
+      free(t);
+      goto nomem;
+    }
+    t->kind = kind;
+    t->next = tags;
+    tags = t;
+  }
+  old = (Tag *) liveContainers->ft->get(liveContainers, container);
+  if (old != t) {
+    if (liveContainers->ft->put(liveContainers, container, t))
+      goto nomem;
+    if (old)
+      old->live--;
+    t->live++;
+  }
+  __atomic_store_n(&registryInUse, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&registryLock);
+  return 0;
+
+nomem:
+  pthread_mutex_unlock(&registryLock);
+  return 1;
+}
+
+/*
+ * called by the release functions, see UTIL_FORGET()
+ */
+void
+forgetContainer(void *container)
+{
+  Tag            *t;
+
+  pthread_mutex_lock(&registryLock);
+  if (liveContainers
+      && (t = (Tag *) liveContainers->ft->get(liveContainers, container))) {
+    t->live--;
+    liveContainers->ft->remove(liveContainers, container);
+  }
+  pthread_mutex_unlock(&registryLock);
+}
+
+void
+sampleContainers(void)
+{
+  pthread_mutex_lock(&registryLock);
+  sampleLocked();
+  pthread_mutex_unlock(&registryLock);
+}
+
+static int
+byBytes(const void *a, const void *b)
+{
+  const Tag      *x = *(const Tag **) a,
+      *y = *(const Tag **) b;
+
+  return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/*
+ * appends one line per name, the biggest first, and a total line:
+ * name=instanceCache kind=hashtable live=3 elements=120 bytes=9480
+ * peakElements=400 peakBytes=30112
+ */
+void
+dumpContainers(UtilStringBuffer * sb)
+{
+  Tag            *t,
+                **sorted;
+  long            n = 0,
+      i,
+      live = 0;
+  unsigned long   bytes = 0;
+  char            line[512];
+
+  pthread_mutex_lock(&registryLock);
+  sampleLocked();
+  for (t = tags; t; t = t->next)
+    n++;
+  if (n && (sorted = (Tag **) malloc(n * sizeof(Tag *)))) {
+    for (i = 0, t = tags; t; t = t->next)
+      sorted[i++] = t;
+    qsort(sorted, n, sizeof(Tag *), byBytes);
+    for (i = 0; i < n; i++) {
+      t = sorted[i];
+      snprintf(line, sizeof(line), "name=%s kind=%s live=%ld elements=%ld "
+               "bytes=%lu peakElements=%ld peakBytes=%lu\n", t->name,
+               kindNames[t->kind], t->live, t->elements, t->bytes,
+               t->peakElements, t->peakBytes);
+      sb->ft->appendChars(sb, line);
+      live += t->live;
+      bytes += t->bytes;
+    }
+    free(sorted);
+  }
+  snprintf(line, sizeof(line), "total live=%ld bytes=%lu\n", live, bytes);
+  sb->ft->appendChars(sb, line);
+  pthread_mutex_unlock(&registryLock);
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,39 @@
+
+/*
+ * utilRegistry.h
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Internal side of the container registry: release functions drop
+ * their container from it.
+ *
+ */
+
+#ifndef _UTILREGISTRY_H_
+#define _UTILREGISTRY_H_
+
+extern int      registryInUse;
+extern void     forgetContainer(void *container);
+
+/*
+ * costs one load until the first container is registered
+ */
+#define UTIL_FORGET(c) \
+  do { \
+    if (__atomic_load_n(&registryInUse, __ATOMIC_RELAXED)) \
+      forgetContainer(c); \
+  } while (0)
+
+#endif                          /* _UTILREGISTRY_H_ */
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -21,30 +21,122 @@
  *
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE             /* mremap() */
+#endif
 #include "utilft.h"
+#include "utilAlloc.h"
+#include "utilRegistry.h"
 // #include "native.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include <sys/mman.h>
+
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+#define SB_USE_MREMAP
+#endif
+
+#define SB_PAGE_SIZE 4096
+#define SB_ROUND_PAGE(n) ((((n) + SB_PAGE_SIZE - 1) / SB_PAGE_SIZE) * SB_PAGE_SIZE)
+
+/*
+ * buffers growing beyond this size move to anonymous mmap() storage,
+ * which mremap() can enlarge without copying the contents 
+ */
+#define SB_MAP_THRESHOLD (4 * 1024 * 1024)
+
+/*
+ * sets the capacity of the buffer to max bytes, which must hold the
+ * current contents 
+ */
+static void
+sbft_resize(UtilStringBuffer * sb, unsigned int max)
+{
+#ifdef SB_USE_MREMAP
+  void           *ns;
+
+  if (sb->mapped || (sb->mapThreshold && max >= sb->mapThreshold
+                     && sb->allocator == NULL)) {
+    max = SB_ROUND_PAGE(max);
+    if (sb->mapped)
+      ns = mremap(sb->hdl, sb->max, max, MREMAP_MAYMOVE);
+    else {
+      ns = mmap(NULL, max, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (ns != MAP_FAILED) {
+        if (sb->hdl) {
+          memcpy(ns, sb->hdl, sb->len + 1);
+          free(sb->hdl);
+        } else
+          *((char *) ns) = 0;
+      }
+    }
+    if (ns != MAP_FAILED) {
+      sb->hdl = ns;
+      sb->max = max;
+      sb->mapped = 1;
+      return;
+    }
+    if (sb->mapped) {
+      /*
+       * out of address space, try the heap 
+       */
+      ns = malloc(max);
+      memcpy(ns, sb->hdl, sb->len + 1);
+      munmap(sb->hdl, sb->max);
+      sb->hdl = ns;
+      sb->max = max;
+      sb->mapped = 0;
+      return;
+    }
+  }
+#endif
+  sb->hdl = utilRealloc(sb->allocator, sb->hdl, sb->max, max);
+  sb->max = max;
+}
 
 static void
 sbft_release(UtilStringBuffer * sb)
 {
+  UTIL_FORGET(sb);
+#ifdef SB_USE_MREMAP
+  if (sb->mapped)
+    munmap(sb->hdl, sb->max);
+  else
+#endif
   if (sb->hdl)
-    free(sb->hdl);
-  free(sb);
+    utilFree(sb->allocator, sb->hdl, sb->max);
+  utilFree(sb->allocator, sb, sizeof(UtilStringBuffer));
 }
 
+/*
+ * a clone lives in the same allocator as the original 
+ */
 static UtilStringBuffer *
 sbft_clone(UtilStringBuffer * sb)
 {
   UtilStringBuffer *nsb =
-      (UtilStringBuffer *) malloc(sizeof(UtilStringBuffer));
+      (UtilStringBuffer *) utilAlloc(sb->allocator, sizeof(UtilStringBuffer));
   *nsb = *sb;
-  if (sb->hdl)
-    nsb->hdl = strdup(sb->hdl);
   nsb->max = nsb->len = sb->len;
+  nsb->mapped = 0;
+  if (sb->hdl) {
+    /*
+     * the length is known, no need to scan for the terminator; this also
+     * keeps blocks with embedded zeros intact 
+     */
+    nsb->max = sb->len + 1;
+    nsb->hdl = utilAlloc(sb->allocator, nsb->max);
+    memcpy(nsb->hdl, sb->hdl, sb->len + 1);
+  }
   return nsb;
 }
 
@@ -60,22 +152,86 @@ sbft_getSize(UtilStringBuffer * sb)
   return (unsigned int) sb->len;
 }
 
+/*
+ * makes room for sl more characters plus the terminating zero; the
+ * capacity doubles until it reaches the growth threshold of the buffer
+ * (if set), beyond that it grows by whole multiples of the growth
+ * increment, which keeps huge buffers page aligned so that realloc()
+ * can move them with mremap() instead of copying 
+ */
+static void
+sbft_ensure(UtilStringBuffer * sb, int sl)
+{
+  unsigned int    need = sl + sb->len + 1,
+      max = sb->max,
+      inc;
+
+  if (need > max) {
+    if (sb->growThreshold && need >= sb->growThreshold) {
+      inc = sb->growIncrement ? sb->growIncrement : SB_PAGE_SIZE;
+      max = ((need + inc) / inc) * inc;
+    } else {
+      if (max == 0)
+        max = 8;
+      while (need > max)
+        max *= 2;
+    }
+    sbft_resize(sb, max);
+  }
+}
+
+/*
+ * presizes the buffer for size characters, appending them does not
+ * grow it again; does not shrink it 
+ */
+static void
+sbft_reserve(UtilStringBuffer * sb, unsigned int size)
+{
+  if (size + 1 > (unsigned int) sb->max) {
+    int             empty = (sb->max == 0);
+
+    sbft_resize(sb, size + 1);
+    if (empty)
+      *((char *) sb->hdl) = 0;
+  }
+}
+
+static void
+sbft_shrinkToFit(UtilStringBuffer * sb)
+{
+  if (sb->hdl && sb->len + 1 < sb->max)
+    sbft_resize(sb, sb->len + 1);
+}
+
+/*
+ * threshold 0 restores plain doubling; increment is rounded up to whole
+ * pages, 0 selects one page 
+ */
+static void
+sbft_setGrowthPolicy(UtilStringBuffer * sb, unsigned int threshold,
+                     unsigned int increment)
+{
+  sb->growThreshold = threshold;
+  sb->growIncrement = SB_ROUND_PAGE(increment);
+}
+
+/*
+ * threshold 0 keeps the buffer on the heap 
+ */
+static void
+sbft_setMapThreshold(UtilStringBuffer * sb, unsigned int threshold)
+{
+  sb->mapThreshold = threshold;
+}
+
 static void
 sbft_appendChars(UtilStringBuffer * sb, const char *chars)
 {
   int             sl;
-  char           *ns;
 
   if (chars == NULL)
     return;
-  if ((sl = strlen(chars)) + sb->len + 1 >= sb->max) {
-    if (sb->max == 0)
-      sb->max = 8;
-    while (sl + sb->len + 1 >= sb->max)
-      sb->max *= 2;
-    ns = (char *) realloc(sb->hdl, sb->max + 2);
-    sb->hdl = ns;
-  }
+  sbft_ensure(sb, sl = strlen(chars));
   memcpy(((char *) sb->hdl) + sb->len, chars, sl + 1);
   sb->len += sl;
 }
@@ -84,35 +240,51 @@ static void
 sbft_appendBlock(UtilStringBuffer * sb, void *data, unsigned int size)
 {
   int             sl;
-  char           *ns;
 
   if (data == NULL)
     return;
-  if ((sl = size) + sb->len + 1 >= sb->max) {
-    if (sb->max == 0)
-      sb->max = 8;
-    while (sl + sb->len + 1 >= sb->max)
-      sb->max *= 2;
-    ns = (char *) realloc(sb->hdl, sb->max + 2);
-    sb->hdl = ns;
-  }
+  sbft_ensure(sb, sl = size);
   memcpy(((char *) sb->hdl) + sb->len, data, sl);
   sb->len += sl;
   ((char *) sb->hdl)[sb->len] = 0;
 }
 
+/*
+ * appends the non NULL pieces after making room for all of them, so a
+ * multi piece append grows the buffer at most once 
+ */
+static void
+sbft_appendPieces(UtilStringBuffer * sb, int n, const char **pieces)
+{
+  int             i,
+                  sl[6],
+                  total = 0;
+  char           *p;
+
+  for (i = 0; i < n; i++)
+    total += sl[i] = pieces[i] ? strlen(pieces[i]) : 0;
+  sbft_ensure(sb, total);
+  p = ((char *) sb->hdl) + sb->len;
+  for (i = 0; i < n; i++)
+    if (sl[i]) {
+      memcpy(p, pieces[i], sl[i]);
+      p += sl[i];
+    }
+  *p = 0;
+  sb->len += total;
+}
+
 static void
 sbft_append6Chars(UtilStringBuffer * sb, const char *chars1,
                   const char *chars2, const char *chars3,
                   const char *chars4, const char *chars5,
                   const char *chars6)
 {
-  sbft_appendChars(sb, chars1);
-  sbft_appendChars(sb, chars2);
-  sbft_appendChars(sb, chars3);
-  sbft_appendChars(sb, chars4);
-  sbft_appendChars(sb, chars5);
-  sbft_appendChars(sb, chars6);
+  const char     *pieces[6] = { chars1, chars2, chars3, chars4, chars5,
+    chars6
+  };
+
+  sbft_appendPieces(sb, 6, pieces);
 }
 
 static void
@@ -120,20 +292,615 @@ sbft_append5Chars(UtilStringBuffer * sb, const char *chars1,
                   const char *chars2, const char *chars3,
                   const char *chars4, const char *chars5)
 {
-  sbft_appendChars(sb, chars1);
-  sbft_appendChars(sb, chars2);
-  sbft_appendChars(sb, chars3);
-  sbft_appendChars(sb, chars4);
-  sbft_appendChars(sb, chars5);
+  const char     *pieces[5] = { chars1, chars2, chars3, chars4, chars5 };
+
+  sbft_appendPieces(sb, 5, pieces);
 }
 
 static void
 sbft_append3Chars(UtilStringBuffer * sb, const char *chars1,
                   const char *chars2, const char *chars3)
 {
-  sbft_appendChars(sb, chars1);
-  sbft_appendChars(sb, chars2);
-  sbft_appendChars(sb, chars3);
+  const char     *pieces[3] = { chars1, chars2, chars3 };
+
+  sbft_appendPieces(sb, 3, pieces);
+}
+
+/*
+ * Numeric appends.  The digits are produced right in the spare capacity
+ * of the buffer, without snprintf() and its locale handling.
+ */
+
+static const char digitPairs[201] =
+    "00010203040506070809" "10111213141516171819"
+    "20212223242526272829" "30313233343536373839"
+    "40414243444546474849" "50515253545556575859"
+    "60616263646566676869" "70717273747576777879"
+    "80818283848586878889" "90919293949596979899";
+
+static const unsigned long long pow10Table[20] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL, 1000000000000000000ULL,
+  10000000000000000000ULL
+};
+
+static int
+countDigits(unsigned long long v)
+{
+  int             n = 1;
+
+  while (n < 20 && v >= pow10Table[n])
+    n++;
+  return n;
+}
+
+/*
+ * writes the n decimal digits of v to p[0] .. p[n-1] 
+ */
+static void
+writeDigits(char *p, int n, unsigned long long v)
+{
+  unsigned        i;
+
+  p += n;
+  while (v >= 100) {
+    i = (unsigned) (v % 100) * 2;
+    v /= 100;
+    *--p = digitPairs[i + 1];
+    *--p = digitPairs[i];
+  }
+  if (v >= 10) {
+    i = (unsigned) v *2;
+    *--p = digitPairs[i + 1];
+    *--p = digitPairs[i];
+  } else
+    *--p = (char) ('0' + v);
+}
+
+static void
+sbft_appendUInt(UtilStringBuffer * sb, unsigned long long v)
+{
+  int             n = countDigits(v);
+  char           *p;
+
+  sbft_ensure(sb, n);
+  p = ((char *) sb->hdl) + sb->len;
+  writeDigits(p, n, v);
+  p[n] = 0;
+  sb->len += n;
+}
+
+static void
+sbft_appendSInt(UtilStringBuffer * sb, long long v)
+{
+  unsigned long long u = (unsigned long long) v;
+  int             neg = (v < 0),
+                  n;
+  char           *p;
+
+  if (neg)
+    u = 0 - u;
+  n = countDigits(u);
+  sbft_ensure(sb, n + neg);
+  p = ((char *) sb->hdl) + sb->len;
+  if (neg)
+    *p++ = '-';
+  writeDigits(p, n, u);
+  p[n] = 0;
+  sb->len += n + neg;
+}
+
+static void
+sbft_appendHex(UtilStringBuffer * sb, unsigned long long v)
+{
+  static const char hexDigits[] = "0123456789abcdef";
+  int             n = 1;
+  char           *p;
+
+  while (n < 16 && (v >> (n * 4)))
+    n++;
+  sbft_ensure(sb, n);
+  p = ((char *) sb->hdl) + sb->len + n;
+  *p = 0;
+  do {
+    *--p = hexDigits[v & 0xf];
+    v >>= 4;
+  } while (v);
+  sb->len += n;
+}
+
+/*
+ * Round-trip formatting of reals, using the Grisu2 algorithm by
+ * Florian Loitsch ("Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers", PLDI 2010).  The output always reads back
+ * to the same value and is the shortest such string in all but a small
+ * fraction of cases, where it has one digit too many.  A number v is
+ * represented as f * 2^e (a "DiyFp"); the boundaries of its rounding
+ * interval are scaled by a cached power of ten into a range where the
+ * digits can be generated with 64 bit integer arithmetic.
+ */
+
+typedef struct {
+  unsigned long long f;
+  int             e;
+} DiyFp;
+
+/*
+ * normalized approximations of 10^-348, 10^-340, ..., 10^340 
+ */
+static const unsigned long long cachedPowersF[87] = {
+  0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+  0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+  0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+  0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+  0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+  0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+  0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+  0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+  0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+  0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+  0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+  0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+  0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+  0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+  0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+  0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+  0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+  0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+  0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+  0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+  0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+  0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+  0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+  0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+  0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+  0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+  0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+  0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+  0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const short cachedPowersE[87] = {
+  -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+  -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+  -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+  -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+  -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+  109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+  375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+  641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+  907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static DiyFp
+diyFpMultiply(DiyFp x, DiyFp y)
+{
+  DiyFp           r;
+#if defined(__SIZEOF_INT128__)
+  unsigned __int128 p = (unsigned __int128) x.f * y.f;
+
+  r.f = (unsigned long long) (p >> 64);
+  if ((unsigned long long) p & (1ULL << 63))
+    r.f++;                      /* round */
+#else
+  const unsigned long long M32 = 0xFFFFFFFFULL;
+  unsigned long long a = x.f >> 32,
+      b = x.f & M32,
+      c = y.f >> 32,
+      d = y.f & M32;
+  unsigned long long ac = a * c,
+      bc = b * c,
+      ad = a * d,
+      bd = b * d;
+  unsigned long long tmp = (bd >> 32) + (ad & M32) + (bc & M32);
+
+  tmp += 1ULL << 31;            /* round */
+  r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+#endif
+  r.e = x.e + y.e + 64;
+  return r;
+}
+
+static DiyFp
+diyFpNormalize(DiyFp x)
+{
+#if defined(__GNUC__)
+  int             s = __builtin_clzll(x.f);
+
+  x.f <<= s;
+  x.e -= s;
+#else
+  while (!(x.f & (1ULL << 63))) {
+    x.f <<= 1;
+    x.e--;
+  }
+#endif
+  return x;
+}
+
+/*
+ * returns c = 10^-K such that the product with a number of binary
+ * exponent e lands in the exponent range [-60,-32] 
+ */
+static DiyFp
+cachedPower(int e, int *K)
+{
+  DiyFp           c;
+  double          dk = (-61 - e) * 0.30102999566398114 + 347;
+  int             k = (int) dk;
+  int             index;
+
+  if (dk - k > 0.0)
+    k++;
+  index = (k >> 3) + 1;
+  *K = -(-348 + (index << 3));
+  c.f = cachedPowersF[index];
+  c.e = cachedPowersE[index];
+  return c;
+}
+
+static void
+grisuRound(char *buf, int len, unsigned long long delta,
+           unsigned long long rest, unsigned long long tenKappa,
+           unsigned long long wpw)
+{
+  while (rest < wpw && delta - rest >= tenKappa &&
+         (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+    buf[len - 1]--;
+    rest += tenKappa;
+  }
+}
+
+static void
+grisuDigitGen(DiyFp W, DiyFp Mp, unsigned long long delta,
+              char *buf, int *len, int *K)
+{
+  DiyFp           one;
+  unsigned long long wpw = Mp.f - W.f,
+      p2,
+      tmp;
+  unsigned        p1,
+                  d;
+  int             kappa;
+
+  one.f = 1ULL << -Mp.e;
+  one.e = Mp.e;
+  p1 = (unsigned) (Mp.f >> -one.e);
+  p2 = Mp.f & (one.f - 1);
+  kappa = countDigits(p1);
+  *len = 0;
+
+  while (kappa > 0) {
+    d = (unsigned) (p1 / pow10Table[kappa - 1]);
+    p1 %= pow10Table[kappa - 1];
+    if (d || *len)
+      buf[(*len)++] = (char) ('0' + d);
+    kappa--;
+    tmp = ((unsigned long long) p1 << -one.e) + p2;
+    if (tmp <= delta) {
+      *K += kappa;
+      grisuRound(buf, *len, delta, tmp, pow10Table[kappa] << -one.e, wpw);
+      return;
+    }
+  }
+
+  for (;;) {
+    p2 *= 10;
+    delta *= 10;
+    d = (unsigned) (p2 >> -one.e);
+    if (d || *len)
+      buf[(*len)++] = (char) ('0' + d);
+    p2 &= one.f - 1;
+    kappa--;
+    if (p2 < delta) {
+      *K += kappa;
+      grisuRound(buf, *len, delta, p2, one.f,
+                 -kappa < 20 ? wpw * pow10Table[-kappa] : 0);
+      return;
+    }
+  }
+}
+
+/*
+ * v = f * 2^e must be finite and positive, lowerCloser is set when
+ * the lower neighbour of v is closer than the upper one 
+ */
+static void
+grisu2(DiyFp v, int lowerCloser, char *buf, int *len, int *K)
+{
+  DiyFp           mPlus,
+                  mMinus,
+                  c,
+                  W,
+                  Wp,
+                  Wm;
+
+  mPlus.f = (v.f << 1) + 1;
+  mPlus.e = v.e - 1;
+  mPlus = diyFpNormalize(mPlus);
+  if (lowerCloser) {
+    mMinus.f = (v.f << 2) - 1;
+    mMinus.e = v.e - 2;
+  } else {
+    mMinus.f = (v.f << 1) - 1;
+    mMinus.e = v.e - 1;
+  }
+  mMinus.f <<= mMinus.e - mPlus.e;
+  mMinus.e = mPlus.e;
+
+  c = cachedPower(mPlus.e, K);
+  W = diyFpMultiply(diyFpNormalize(v), c);
+  Wp = diyFpMultiply(mPlus, c);
+  Wm = diyFpMultiply(mMinus, c);
+  Wm.f++;
+  Wp.f--;
+  grisuDigitGen(W, Wp, Wp.f - Wm.f, buf, len, K);
+}
+
+/*
+ * turns the len digits in buf, scaled by 10^k, into a CIM real literal
+ * in place; returns the length of the result 
+ */
+static int
+prettifyReal(char *buf, int len, int k)
+{
+  int             kk = len + k; /* 10^(kk-1) <= v < 10^kk */
+  int             i,
+                  n,
+                  e;
+
+  if (k >= 0 && kk <= 21) {     /* 1234e7 -> 12340000000.0 */
+    for (i = len; i < kk; i++)
+      buf[i] = '0';
+    buf[kk] = '.';
+    buf[kk + 1] = '0';
+    return kk + 2;
+  }
+  if (kk > 0 && kk <= 21) {     /* 1234e-2 -> 12.34 */
+    memmove(buf + kk + 1, buf + kk, len - kk);
+    buf[kk] = '.';
+    return len + 1;
+  }
+  if (kk > -6 && kk <= 0) {     /* 1234e-6 -> 0.001234 */
+    i = 2 - kk;
+    memmove(buf + i, buf, len);
+    buf[0] = '0';
+    buf[1] = '.';
+    memset(buf + 2, '0', i - 2);
+    return len + i;
+  }
+  if (len == 1) {               /* 1e30 -> 1.0e30 */
+    buf[1] = '.';
+    buf[2] = '0';
+    i = 3;
+  } else {                      /* 1234e30 -> 1.234e33 */
+    memmove(buf + 2, buf + 1, len - 1);
+    buf[1] = '.';
+    i = len + 1;
+  }
+  buf[i++] = 'e';
+  e = kk - 1;
+  if (e < 0) {
+    buf[i++] = '-';
+    e = -e;
+  }
+  n = countDigits(e);
+  writeDigits(buf + i, n, e);
+  return i + n;
+}
+
+/*
+ * appends v = f * 2^e, f == 0 denoting zero 
+ */
+static void
+appendDiyFp(UtilStringBuffer * sb, int neg, DiyFp v, int lowerCloser)
+{
+  char           *p;
+  int             n,
+                  K;
+
+  /*
+   * at most 17 digits, a sign, "0." and 5 leading zeros or a point, 'e'
+   * and a 4 character exponent 
+   */
+  sbft_ensure(sb, 32);
+  p = ((char *) sb->hdl) + sb->len;
+  if (neg)
+    *p++ = '-';
+  if (v.f == 0) {
+    memcpy(p, "0.0", 4);
+    n = 3;
+  } else {
+    grisu2(v, lowerCloser, p, &n, &K);
+    n = prettifyReal(p, n, K);
+    p[n] = 0;
+  }
+  sb->len += n + neg;
+}
+
+static void
+sbft_appendReal(UtilStringBuffer * sb, double d)
+{
+  unsigned long long bits,
+                  m;
+  int             be;
+  DiyFp           v;
+
+  memcpy(&bits, &d, sizeof(bits));
+  m = bits & 0x000FFFFFFFFFFFFFULL;
+  be = (int) ((bits >> 52) & 0x7FF);
+  if (be == 0x7FF) {
+    sbft_appendChars(sb, m ? "NaN" : (bits >> 63) ? "-INF" : "INF");
+    return;
+  }
+  if (be) {
+    v.f = m | 0x0010000000000000ULL;
+    v.e = be - 1075;
+  } else {
+    v.f = m;
+    v.e = -1074;
+  }
+  appendDiyFp(sb, (int) (bits >> 63), v, m == 0 && be > 1);
+}
+
+static void
+sbft_appendReal32(UtilStringBuffer * sb, float r)
+{
+  unsigned int    bits,
+                  m;
+  int             be;
+  DiyFp           v;
+
+  memcpy(&bits, &r, sizeof(bits));
+  m = bits & 0x007FFFFF;
+  be = (int) ((bits >> 23) & 0xFF);
+  if (be == 0xFF) {
+    sbft_appendChars(sb, m ? "NaN" : (bits >> 31) ? "-INF" : "INF");
+    return;
+  }
+  if (be) {
+    v.f = m | 0x00800000;
+    v.e = be - 150;
+  } else {
+    v.f = m;
+    v.e = -149;
+  }
+  appendDiyFp(sb, (int) (bits >> 31), v, m == 0 && be > 1);
+}
+
+/*
+ * XML escaping.  Runs of characters that need no escaping are located
+ * 32 or 16 bytes at a time (AVX2/SSE2, or 8 bytes at a time in a
+ * general purpose register elsewhere) and copied in one piece.
+ */
+
+static const char xmlSpecial[256] = {
+  ['"'] = 1,['&'] = 1,['\''] = 1,['<'] = 1,['>'] = 1
+};
+
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+#define SWAR_HAS_BYTE(x,c) \
+  ((((x) ^ (SWAR_ONES * (c))) - SWAR_ONES) & ~((x) ^ (SWAR_ONES * (c))) & SWAR_HIGHS)
+
+/*
+ * returns the number of leading characters of s[0] .. s[n-1] that do not
+ * need to be escaped 
+ */
+static size_t
+xmlCleanRun(const char *s, size_t n)
+{
+  size_t          i = 0;
+
+#if defined(__AVX2__)
+  const __m256i   lt32 = _mm256_set1_epi8('<'),
+      gt32 = _mm256_set1_epi8('>'),
+      amp32 = _mm256_set1_epi8('&'),
+      quot32 = _mm256_set1_epi8('"'),
+      apos32 = _mm256_set1_epi8('\'');
+
+  for (; i + 32 <= n; i += 32) {
+    __m256i         c = _mm256_loadu_si256((const __m256i *) (s + i));
+    __m256i         m = _mm256_cmpeq_epi8(c, lt32);
+    unsigned        mask;
+
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(c, gt32));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(c, amp32));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(c, quot32));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(c, apos32));
+    if ((mask = (unsigned) _mm256_movemask_epi8(m)))
+      return i + __builtin_ctz(mask);
+  }
+#endif
+#if defined(__SSE2__)
+  {
+    const __m128i   lt = _mm_set1_epi8('<'),
+        gt = _mm_set1_epi8('>'),
+        amp = _mm_set1_epi8('&'),
+        quot = _mm_set1_epi8('"'),
+        apos = _mm_set1_epi8('\'');
+
+    for (; i + 16 <= n; i += 16) {
+      __m128i         c = _mm_loadu_si128((const __m128i *) (s + i));
+      __m128i         m = _mm_cmpeq_epi8(c, lt);
+      unsigned        mask;
+
+      m = _mm_or_si128(m, _mm_cmpeq_epi8(c, gt));
+      m = _mm_or_si128(m, _mm_cmpeq_epi8(c, amp));
+      m = _mm_or_si128(m, _mm_cmpeq_epi8(c, quot));
+      m = _mm_or_si128(m, _mm_cmpeq_epi8(c, apos));
+      if ((mask = (unsigned) _mm_movemask_epi8(m)))
+        return i + __builtin_ctz(mask);
+    }
+  }
+#else
+  for (; i + 8 <= n; i += 8) {
+    unsigned long long x;
+
+    memcpy(&x, s + i, 8);
+    if (SWAR_HAS_BYTE(x, '<') | SWAR_HAS_BYTE(x, '>') |
+        SWAR_HAS_BYTE(x, '&') | SWAR_HAS_BYTE(x, '"') |
+        SWAR_HAS_BYTE(x, '\''))
+      break;
+  }
+#endif
+  while (i < n && !xmlSpecial[(unsigned char) s[i]])
+    i++;
+  return i;
+}
+
+static void
+sbft_appendXmlEscaped(UtilStringBuffer * sb, const char *chars)
+{
+  size_t          n,
+                  run;
+  const char     *esc;
+  int             el;
+  char           *p;
+
+  if (chars == NULL)
+    return;
+  n = strlen(chars);
+  sbft_ensure(sb, n);
+  for (;;) {
+    run = xmlCleanRun(chars, n);
+    memcpy(((char *) sb->hdl) + sb->len, chars, run);
+    sb->len += run;
+    if (run == n)
+      break;
+    switch (chars[run]) {
+    case '<':
+      esc = "&lt;";
+      el = 4;
+      break;
+    case '>':
+      esc = "&gt;";
+      el = 4;
+      break;
+    case '&':
+      esc = "&amp;";
+      el = 5;
+      break;
+    case '"':
+      esc = "&quot;";
+      el = 6;
+      break;
+    default:
+      esc = "&apos;";
+      el = 6;
+      break;
+    }
+    chars += run + 1;
+    n -= run + 1;
+    sbft_ensure(sb, el + n);
+    p = ((char *) sb->hdl) + sb->len;
+    memcpy(p, esc, el);
+    sb->len += el;
+  }
+  ((char *) sb->hdl)[sb->len] = 0;
 }
 
 /*
@@ -157,11 +924,67 @@ sbft_reset(UtilStringBuffer * sb)
   sb->len = 0;
 }
 
+/*
+ * hands the backing allocation over to the caller, who gives it back with
+ * releaseDetached(); the buffer itself is left empty and can be reused.
+ * A mapped buffer is handed over as is, trimmed to the pages in use.
+ * Allocator backed contents are copied to the heap first, the allocator
+ * owns their memory.
+ */
+static char    *
+sbft_detach(UtilStringBuffer * sb, unsigned int *len)
+{
+  char           *buf = (char *) sb->hdl;
+
+  if (sb->allocator && buf) {
+    buf = (char *) malloc(sb->len + 1);
+    memcpy(buf, sb->hdl, sb->len + 1);
+    utilFree(sb->allocator, sb->hdl, sb->max);
+  }
+#ifdef SB_USE_MREMAP
+  if (sb->mapped) {
+    size_t          used = SB_ROUND_PAGE((size_t) sb->len + 1);
+
+    if (used < (size_t) sb->max)
+      munmap(buf + used, sb->max - used);
+    sb->mapped = 0;
+  }
+#endif
+  if (len)
+    *len = (unsigned int) sb->len;
+  sb->hdl = NULL;
+  sb->max = 0;
+  sb->len = 0;
+  return buf;
+}
+
+/*
+ * frees what detach() returned; mapped is the mapped flag the buffer had
+ * before the detach, len the length detach() reported
+ */
+static void
+sbft_releaseDetached(char *buf, unsigned int len, int mapped)
+{
+  if (buf == NULL)
+    return;
+#ifdef SB_USE_MREMAP
+  if (mapped) {
+    munmap(buf, SB_ROUND_PAGE((size_t) len + 1));
+    return;
+  }
+#endif
+  free(buf);
+}
+
+/*
+ * the buffer and its contents are allocated by al, which may be NULL;
+ * such buffers are never moved to mmap() storage 
+ */
 UtilStringBuffer *
-newStringBuffer(int s)
+newStringBufferWithAllocator(const UtilAllocator * al, int s)
 {
   static Util_StringBuffer_FT sbft = {
-    UTIL_FT_VERSION,
+    2,
     sbft_release,
     sbft_clone,
     sbft_getCharPtr,
@@ -172,22 +995,51 @@ newStringBuffer(int s)
     sbft_appendBlock,
     sbft_append3Chars,
     sbft_append5Chars,
-    sbft_append6Chars
+    sbft_append6Chars,
+    sbft_detach,
+    sbft_appendUInt,
+    sbft_appendSInt,
+    sbft_appendReal,
+    sbft_appendReal32,
+    sbft_appendHex,
+    sbft_appendXmlEscaped,
+    sbft_reserve,
+    sbft_shrinkToFit,
+    sbft_setGrowthPolicy,
+    sbft_setMapThreshold,
+    sbft_releaseDetached
   };
 
   UtilStringBuffer *sb =
-      (UtilStringBuffer *) malloc(sizeof(UtilStringBuffer));
+      (UtilStringBuffer *) utilAlloc(al, sizeof(UtilStringBuffer));
 
   if (s == 0)
     s = 32;
-  sb->hdl = malloc(s);
+  sb->hdl = utilAlloc(al, s);
   *((char *) sb->hdl) = 0;
   sb->ft = &sbft;
   sb->max = s;
   sb->len = 0;
+  sb->growThreshold = 0;
+  sb->growIncrement = 0;
+  sb->mapThreshold = al ? 0 : SB_MAP_THRESHOLD;
+  sb->mapped = 0;
+  sb->allocator = al;
 
   return sb;
 }
+
+UtilStringBuffer *
+newStringBuffer(int s)
+{
+  return newStringBufferWithAllocator(NULL, s);
+}
+
+UtilStringBuffer *
+newStringBufferInArena(UtilArena * arena, int s)
+{
+  return newStringBufferWithAllocator(arenaAllocator(arena), s);
+}
 /* MODELINES */
 /* DO NOT EDIT BELOW THIS COMMENT */
 /* Modelines are added by 'make pretty' */
@@ -0,0 +1,293 @@
+
+/*
+ * utilThreadPool.c
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Description:
+ *
+ * Work-stealing thread pool.
+ *
+ * Every worker owns a UtilDeque.  Tasks submitted by a running task
+ * (one request fanned out to many providers or namespaces) are pushed
+ * onto the deque of the worker running it and popped from there in
+ * LIFO order; tasks submitted from any other thread go through a shared
+ * unbounded UtilQueue.  A worker without work of its own takes from the
+ * shared queue, then steals from the other workers, and finally sleeps
+ * until the next submit.
+ *
+ */
+
+#include "utilft.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+extern UtilQueue *newQueue(unsigned long capacity);
+extern UtilDeque *newDeque(void);
+
+/*
+ * rounds of looking for work before a worker goes to sleep
+ */
+#define POOL_SPIN 64
+
+typedef struct {
+  void            (*fn) (void *);
+  void           *arg;
+} Task;
+
+struct _Pool;
+
+typedef struct {
+  struct _Pool   *pool;
+  UtilDeque      *deque;
+  unsigned int    seed;         /* victim selection */
+  pthread_t       tid;
+} Worker;
+
+typedef struct _Pool {
+  int             n;
+  Worker         *workers;
+  UtilQueue      *inject;       /* tasks from outside the pool */
+  long            pending;      /* submitted, not yet finished */
+  long            queued;       /* submitted, not yet taken */
+  int             sleepers;
+  int             shutdown;
+  pthread_mutex_t lock;
+  pthread_cond_t  work,
+                  done;
+} Pool;
+
+/*
+ * the worker running on this thread, if any
+ */
+static __thread Worker *self;
+
+static Task    *
+findTask(Pool * p, Worker * w)
+{
+  Task           *t;
+  Worker         *v;
+  int             start,
+                  i;
+
+  if ((t = (Task *) w->deque->ft->pop(w->deque)))
+    return t;
+  if ((t = (Task *) p->inject->ft->removeFirst(p->inject)))
+    return t;
+  w->seed ^= w->seed << 13;
+  w->seed ^= w->seed >> 17;
+  w->seed ^= w->seed << 5;
+  start = w->seed % p->n;
+  for (i = 0; i < p->n; i++) {
+    v = &p->workers[(start + i) % p->n];
+    if (v != w && (t = (Task *) v->deque->ft->steal(v->deque)))
+      return t;
+  }
+  return NULL;
+}
+
+static void
+finish(Pool * p)
+{
+  if (__atomic_sub_fetch(&p->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_broadcast(&p->done);
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+
+static void    *
+worker(void *arg)
+{
+  Worker         *w = (Worker *) arg;
+  Pool           *p = w->pool;
+  Task           *t;
+  int             idle = 0,
+      stop;
+
+  self = w;
+  for (;;) {
+    if ((t = findTask(p, w))) {
+      __atomic_sub_fetch(&p->queued, 1, __ATOMIC_SEQ_CST);
+      t->fn(t->arg);
+      free(t);
+      finish(p);
+      idle = 0;
+      continue;
+    }
+    if (++idle < POOL_SPIN) {
+      sched_yield();
+      continue;
+    }
+    /*
+     * sleepers is raised before queued is checked and submit raises
+     * queued before it checks sleepers, so a wakeup cannot get lost
+     */
+    pthread_mutex_lock(&p->lock);
+    __atomic_add_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    while (!p->shutdown
+           && __atomic_load_n(&p->queued, __ATOMIC_SEQ_CST) == 0)
+      pthread_cond_wait(&p->work, &p->lock);
+    __atomic_sub_fetch(&p->sleepers, 1, __ATOMIC_SEQ_CST);
+    stop = p->shutdown;
+    pthread_mutex_unlock(&p->lock);
+    if (stop)
+      break;
+    idle = 0;
+  }
+  self = NULL;
+  return NULL;
+}
+
+static int
+poolSubmit(UtilThreadPool * tp, void (*fn) (void *), void *arg)
+{
+  Pool           *p = (Pool *) tp->hdl;
+  Task           *t = (Task *) malloc(sizeof(Task));
+  int             rc;
+
+  if (t == NULL)
+    return 1;
+  t->fn = fn;
+  t->arg = arg;
+  __atomic_add_fetch(&p->pending, 1, __ATOMIC_ACQ_REL);
+  if (self && self->pool == p)
+    rc = self->deque->ft->push(self->deque, t);
+  else
+    rc = p->inject->ft->append(p->inject, t);
+  if (rc) {
+    free(t);
+    finish(p);
+    return 1;
+  }
+  __atomic_add_fetch(&p->queued, 1, __ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&p->sleepers, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_signal(&p->work);
+    pthread_mutex_unlock(&p->lock);
+  }
+  return 0;
+}
+
+static void
+poolWait(UtilThreadPool * tp)
+{
+  Pool           *p = (Pool *) tp->hdl;
+
+  pthread_mutex_lock(&p->lock);
+  while (__atomic_load_n(&p->pending, __ATOMIC_ACQUIRE))
+    pthread_cond_wait(&p->done, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+}
+
+static int
+poolThreads(UtilThreadPool * tp)
+{
+  return ((Pool *) tp->hdl)->n;
+}
+
+/*
+ * stops and joins the first started workers and frees the pool
+ */
+static void
+stopPool(Pool * p, int started)
+{
+  int             i;
+
+  pthread_mutex_lock(&p->lock);
+  p->shutdown = 1;
+  pthread_cond_broadcast(&p->work);
+  pthread_mutex_unlock(&p->lock);
+  for (i = 0; i < started; i++)
+    pthread_join(p->workers[i].tid, NULL);
+  for (i = 0; p->workers && i < p->n; i++)
+    if (p->workers[i].deque)
+      p->workers[i].deque->ft->release(p->workers[i].deque);
+  if (p->inject)
+    p->inject->ft->release(p->inject);
+  pthread_cond_destroy(&p->done);
+  pthread_cond_destroy(&p->work);
+  pthread_mutex_destroy(&p->lock);
+  free(p->workers);
+  free(p);
+}
+
+static void
+poolRelease(UtilThreadPool * tp)
+{
+  poolWait(tp);
+  stopPool((Pool *) tp->hdl, ((Pool *) tp->hdl)->n);
+  free(tp);
+}
+
+static Util_ThreadPool_FT tpft = {
+  1,
+  poolRelease,
+  poolSubmit,
+  poolWait,
+  poolThreads
+};
+
+UtilThreadPool *
+newThreadPool(int threads)
+{
+  UtilThreadPool *tp;
+  Pool           *p;
+  int             i;
+
+  if (threads <= 0)
+    threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads <= 0)
+    threads = 1;
+
+  if ((tp = (UtilThreadPool *) malloc(sizeof(UtilThreadPool))) == NULL)
+    return NULL;
+  if ((p = (Pool *) calloc(1, sizeof(Pool))) == NULL) {
+    free(tp);
+    return NULL;
+  }
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->work, NULL);
+  pthread_cond_init(&p->done, NULL);
+  p->n = threads;
+  p->workers = (Worker *) calloc(threads, sizeof(Worker));
+  p->inject = newQueue(0);
+  if (p->workers == NULL || p->inject == NULL) {
+    stopPool(p, 0);
+    free(tp);
+    return NULL;
+  }
+  for (i = 0; i < threads; i++) {
+    p->workers[i].pool = p;
+    p->workers[i].seed = 2654435761u * (i + 1);
+    if ((p->workers[i].deque = newDeque()) == NULL) {
+      stopPool(p, 0);
+      free(tp);
+      return NULL;
+    }
+  }
+  for (i = 0; i < threads; i++)
+    if (pthread_create(&p->workers[i].tid, NULL, worker, &p->workers[i])) {
+      stopPool(p, i);
+      free(tp);
+      return NULL;
+    }
+
+  tp->hdl = p;
+  tp->ft = &tpft;
+  return tp;
+}
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
@@ -0,0 +1,104 @@
+
+/*
+ * utilTypeCk.h
+ *
+ * (C) Copyright IBM Corp. 2011
+ *
+ * THIS FILE IS PROVIDED UNDER THE TERMS OF THE ECLIPSE PUBLIC LICENSE
+ * ("AGREEMENT"). ANY USE, REPRODUCTION OR DISTRIBUTION OF THIS FILE
+ * CONSTITUTES RECIPIENTS ACCEPTANCE OF THE AGREEMENT.
+ *
+ * You can obtain a current copy of the Eclipse Public License from
+ * http://www.opensource.org/licenses/eclipse-1.0.php
+ *
+ * Author:        Narasimha Sharoff <nsharoff@us.ibm.com>
+ *
+ * Description:
+ *
+ * CIM type validation routines : return 1 on failure
+ *
+ */
+
+#ifndef _UTILTYPECK_H_
+#define _UTILTYPECK_H_
+
+#include <stddef.h>
+#include "cmpi/cmpidt.h"
+
+#ifdef __cplusplus
+extern          "C" {
+#endif
+
+  int             invalid_uint(const char *v, const CMPIType type);
+  int             invalid_int(const char *v, const CMPIType type);
+  int             invalid_real(const char *v, const CMPIType type);
+  int             invalid_boolean(const char *v, const CMPIType type);
+  int             invalid_char16(const char *v, const CMPIType type);
+  int             invalid_string(const char *v, const CMPIType type);
+  int             invalid_datetime(const char *v, const CMPIType type);
+  int             invalid_ref(const char *v, const CMPIType type);
+  /*
+   * any of the above, selected by type 
+   */
+  int             invalid_value(const char *v, const CMPIType type);
+
+  /*
+   * validate and convert: on success the member of val matching type
+   * is set, val may be NULL 
+   */
+  int             parse_uint(const char *v, const CMPIType type,
+                             CMPIValue * val);
+  int             parse_int(const char *v, const CMPIType type,
+                            CMPIValue * val);
+  int             parse_real(const char *v, const CMPIType type,
+                             CMPIValue * val);
+  int             parse_boolean(const char *v, const CMPIType type,
+                                CMPIValue * val);
+  int             parse_char16(const char *v, const CMPIType type,
+                               CMPIValue * val);
+  /*
+   * "true" or "false" in any case at v[0] .. v[len-1], b may be NULL 
+   */
+  int             parse_boolean_n(const char *v, size_t len,
+                                  CMPIBoolean * b);
+  /*
+   * dispatches on type to one of the above; string, chars, dateTime
+   * and ref values are only validated 
+   */
+  int             parse_value(const char *v, const CMPIType type,
+                              CMPIValue * val);
+
+  /*
+   * the same for the len characters at v, which need not be NUL
+   * terminated 
+   */
+  int             invalid_value_n(const char *v, size_t len,
+                                  const CMPIType type);
+  int             parse_value_n(const char *v, size_t len,
+                                const CMPIType type, CMPIValue * val);
+
+  /*
+   * batch validation of the count strings in v, or of the delim
+   * separated values in buf; the index of the first invalid value is
+   * stored in *failed, vals (may be NULL) receives one result per value 
+   */
+  int             invalid_array(const char *const *v, unsigned int count,
+                                const CMPIType type, unsigned int *failed);
+  int             parse_array(const char *const *v, unsigned int count,
+                              const CMPIType type, CMPIValue * vals,
+                              unsigned int *failed);
+  int             invalid_list(const char *buf, size_t len, char delim,
+                               const CMPIType type, unsigned int *failed);
+  int             parse_list(const char *buf, size_t len, char delim,
+                             const CMPIType type, CMPIValue * vals,
+                             unsigned int *failed);
+
+#ifdef __cplusplus
+}
+#endif
+#endif                          // _UTILTYPECK_H_
+/* MODELINES */
+/* DO NOT EDIT BELOW THIS COMMENT */
+/* Modelines are added by 'make pretty' */
+/* -*- Mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+/* vi:set ts=2 sts=2 sw=2 expandtab: */
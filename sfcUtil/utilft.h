@@ -26,12 +26,57 @@
 #define _UTILFT_H_
 
 // #include "providerRegister.h"
+#include <stddef.h>
 #include "hashtable.h"
 
 #ifdef __cplusplus
 extern          "C" {
 #endif
 
+  /*
+   * bump allocator for request scoped containers, see utilArena.c 
+   */
+  struct _UtilArena;
+  typedef struct _UtilArena UtilArena;
+
+  /*
+   * allocator hooks of a container, ctx is passed to each of them;
+   * realloc and free get the size the block was allocated with.  The
+   * allocator must outlive the containers using it. 
+   */
+  struct _UtilAllocator {
+    void           *(*alloc) (void *ctx, size_t size);
+    void           *(*realloc) (void *ctx, void *p, size_t oldSize,
+                                size_t size);
+    void            (*free) (void *ctx, void *p, size_t size);
+    void           *ctx;
+  };
+  typedef struct _UtilAllocator UtilAllocator;
+
+  /*
+   * filled in by Util_HashTable_FT stats; the counters are only kept
+   * when libsfcUtil is built with HASHTABLE_STATS (configure
+   * --enable-hashtable-stats) 
+   */
+#define UtilHashTable_probeBuckets 16
+  typedef struct _UtilHashTableStats {
+    long            size,
+                    buckets,
+                    usedBuckets,
+                    longestChain;
+    unsigned long   gets,       /* includes containsKey */
+                    hits,
+                    puts,
+                    removes,
+                    rehashes;
+    double          rehashSeconds;
+    /*
+     * lookups by the number of pairs they looked at, the last bucket
+     * counts everything longer 
+     */
+    unsigned long   probes[UtilHashTable_probeBuckets];
+  } UtilHashTableStats;
+
   struct _Util_HashTable_FT;
   typedef struct _Util_HashTable_FT Util_HashTable_FT;
 
@@ -90,6 +135,13 @@ extern          "C" {
     void (*setReleaseFunctions)
         (UtilHashTable * ht, void (*keyRelease) (void *key),
          void (*valueRelease) (void *value));
+
+    /*
+     * version 2: 0 if st holds live counters, 1 if they are compiled
+     * out and only the size and chain fields are set 
+     */
+    int (*stats)
+        (const UtilHashTable * ht, UtilHashTableStats * st);
   };
 
 #define UtilHashTable_charKey 1
@@ -115,6 +167,10 @@ extern          "C" {
     int             version;
     void            (*release)
                     (UtilList * ul);
+    /*
+     * always NULL: the memRelease hook given to newList() is kept with
+     * each list and called by release 
+     */
     void            (*memUnlink)
                     (int i);
     UtilList       *(*clone)
@@ -159,6 +215,11 @@ extern          "C" {
     Util_StringBuffer_FT *ft;
     int             max,
                     len;
+    unsigned int    growThreshold,
+                    growIncrement,
+                    mapThreshold;
+    int             mapped;
+    const UtilAllocator *allocator;
   };
   typedef struct _UtilStringBuffer UtilStringBuffer;
 
@@ -190,6 +251,133 @@ extern          "C" {
                                      const char *chars4,
                                      const char *chars5,
                                      const char *chars6);
+    /*
+     * version 2: detach, numeric and XML escaped appends, capacity
+     * control and mmap() backing 
+     */
+    /*
+     * hands the contents over without copying them, unless the buffer
+     * has an allocator; give them back with releaseDetached(), passing
+     * the mapped flag the buffer had before the call: contents moved to
+     * mmap() storage (see setMapThreshold) are returned as a mapping,
+     * which free() must not see 
+     */
+    char           *(*detach) (UtilStringBuffer * sb, unsigned int *len);
+    void            (*appendUInt) (UtilStringBuffer * sb,
+                                   unsigned long long v);
+    void            (*appendSInt) (UtilStringBuffer * sb, long long v);
+    void            (*appendReal) (UtilStringBuffer * sb, double v);
+    void            (*appendReal32) (UtilStringBuffer * sb, float v);
+    void            (*appendHex) (UtilStringBuffer * sb,
+                                  unsigned long long v);
+    void            (*appendXmlEscaped) (UtilStringBuffer * sb,
+                                         const char *chars);
+    void            (*reserve) (UtilStringBuffer * sb, unsigned int size);
+    void            (*shrinkToFit) (UtilStringBuffer * sb);
+    void            (*setGrowthPolicy) (UtilStringBuffer * sb,
+                                        unsigned int threshold,
+                                        unsigned int increment);
+    void            (*setMapThreshold) (UtilStringBuffer * sb,
+                                        unsigned int threshold);
+    void            (*releaseDetached) (char *buf, unsigned int len,
+                                        int mapped);
+  };
+
+  /*
+   * lock-free multi-producer/multi-consumer queue of non NULL pointers,
+   * see utilQueue.c; the operations are named after their UtilList
+   * counterparts (enqueue and dequeue are macros in genericlist.h) 
+   */
+  struct _Util_Queue_FT;
+  typedef struct _Util_Queue_FT Util_Queue_FT;
+
+  struct _UtilQueue {
+    void           *hdl;
+    Util_Queue_FT  *ft;
+  };
+  typedef struct _UtilQueue UtilQueue;
+
+  struct _Util_Queue_FT {
+    int             version;
+    void            (*release) (UtilQueue * q);
+    /*
+     * 0 on success, 1 if the queue is full or elm is NULL 
+     */
+    int             (*append) (UtilQueue * q, void *elm);
+    /*
+     * NULL if the queue is empty 
+     */
+    void           *(*removeFirst) (UtilQueue * q);
+    int             (*isEmpty) (UtilQueue * q);
+    /*
+     * 0 for unbounded queues 
+     */
+    unsigned long   (*capacity) (UtilQueue * q);
+  };
+
+  /*
+   * Chase-Lev work-stealing deque of non NULL pointers, see utilDeque.c;
+   * push and pop belong to the owning thread, steal may be called by any
+   * thread 
+   */
+  struct _Util_Deque_FT;
+  typedef struct _Util_Deque_FT Util_Deque_FT;
+
+  struct _UtilDeque {
+    void           *hdl;
+    Util_Deque_FT  *ft;
+  };
+  typedef struct _UtilDeque UtilDeque;
+
+  struct _Util_Deque_FT {
+    int             version;
+    void            (*release) (UtilDeque * dq);
+    /*
+     * 0 on success, 1 if out of memory 
+     */
+    int             (*push) (UtilDeque * dq, void *elm);
+    /*
+     * newest element, NULL if empty 
+     */
+    void           *(*pop) (UtilDeque * dq);
+    /*
+     * oldest element, NULL if empty 
+     */
+    void           *(*steal) (UtilDeque * dq);
+    int             (*isEmpty) (UtilDeque * dq);
+  };
+
+  /*
+   * fixed size pool of worker threads with one UtilDeque each, see
+   * utilThreadPool.c; tasks submitted from inside a task go to the
+   * deque of the worker running it, idle workers steal 
+   */
+  struct _Util_ThreadPool_FT;
+  typedef struct _Util_ThreadPool_FT Util_ThreadPool_FT;
+
+  struct _UtilThreadPool {
+    void           *hdl;
+    Util_ThreadPool_FT *ft;
+  };
+  typedef struct _UtilThreadPool UtilThreadPool;
+
+  struct _Util_ThreadPool_FT {
+    int             version;
+    /*
+     * waits for all tasks, then stops the workers 
+     */
+    void            (*release) (UtilThreadPool * tp);
+    /*
+     * 0 on success, 1 if out of memory 
+     */
+    int             (*submit) (UtilThreadPool * tp, void (*fn) (void *),
+                               void *arg);
+    /*
+     * returns when every task submitted so far, and every task those
+     * submitted, has finished; not to be called from a task 
+     */
+    void            (*wait) (UtilThreadPool * tp);
+    int             (*threads) (UtilThreadPool * tp);
   };
 
   struct _Util_Factory_FT;
@@ -202,10 +390,58 @@ extern          "C" {
     UtilList       *(*newList) ();
     // ProviderRegister *(*newProviderRegister) (char *fn);
     UtilStringBuffer *(*newStrinBuffer) (int s);
+    /*
+     * version 2: arenas; all memory of the containers created in an
+     * arena (nodes, buckets, buffers) comes from the arena and is freed
+     * by resetArena() or releaseArena().  chunkSize 0 selects the
+     * default. 
+     */
+    UtilArena      *(*newArena) (unsigned long chunkSize);
+    void            (*resetArena) (UtilArena * a);
+    void            (*releaseArena) (UtilArena * a);
+    UtilHashTable  *(*newHashTableInArena) (UtilArena * a, long buckets,
+                                            long opt);
+    UtilList       *(*newListInArena) (UtilArena * a);
+    UtilStringBuffer *(*newStringBufferInArena) (UtilArena * a, int s);
+    /*
+     * version 3: containers with their own allocator (NULL: malloc()),
+     * the allocator of an arena 
+     */
+    UtilHashTable  *(*newHashTableWithAllocator) (const UtilAllocator *
+                                                  al, long buckets,
+                                                  long opt);
+    UtilList       *(*newListWithAllocator) (const UtilAllocator * al);
+    UtilStringBuffer *(*newStringBufferWithAllocator) (const UtilAllocator
+                                                       * al, int s);
+    const UtilAllocator *(*arenaAllocator) (UtilArena * a);
+    /*
+     * version 4: lock-free queues, bounded (capacity is rounded up to a
+     * power of two) or unbounded (capacity 0) 
+     */
+    UtilQueue      *(*newQueue) (unsigned long capacity);
+    /*
+     * version 5: work-stealing deques and a thread pool on top of them,
+     * threads 0 starts one worker per online CPU 
+     */
+    UtilDeque      *(*newDeque) ();
+    UtilThreadPool *(*newThreadPool) (int threads);
+    /*
+     * version 6: registry of live containers, see utilRegistry.c; kind
+     * is one of the UtilRegistry_ values, dumpContainers() appends a
+     * report to sb 
+     */
+    int             (*registerContainer) (void *container, int kind,
+                                          const char *name);
+    void            (*sampleContainers) ();
+    void            (*dumpContainers) (UtilStringBuffer * sb);
   };
 
   extern Util_Factory_FT *UtilFactory;
 
+#define UtilRegistry_hashTable 1
+#define UtilRegistry_list 2
+#define UtilRegistry_stringBuffer 3
+
 #define SFCB_APPENDCHARS_BLOCK(sb,c) (sb)->ft->appendBlock((sb),c,sizeof(c)-1)
 
 #ifdef __cplusplus